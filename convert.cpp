@@ -0,0 +1,107 @@
+#include <mesh_asset.h>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include <util/mesh.hpp>
+
+#include <cmdparser.hpp>
+
+using namespace kouek;
+
+int main(int argc, char **argv) {
+    // Command parser
+    cli::Parser parser(argc, argv);
+    parser.set_required<std::string>(
+        "m", "model", "OBJ, PLY or Uncompressed Binary Mesh Model Path");
+    parser.set_required<std::string>("o", "output", "Binary Mesh File Path");
+    parser.set_optional<uint32_t>(
+        "z", "compress-bits", 0,
+        "Bits per Quantized Position Coordinate to Compress with, 0 to "
+        "Store Uncompressed");
+    parser.set_optional<bool>(
+        "p", "paged", false,
+        "Store Faces in Pages by Octree Leaf for Out-of-Core Rendering");
+    parser.run_and_exit_if_error();
+
+    // Load model, a binary mesh as is, mapped in place, so that models
+    // larger than memory can be paged
+    auto modelPath = parser.get<std::string>("m");
+    auto asset = MeshAsset::Load(modelPath);
+    if (asset)
+        std::cout << "Model: " << modelPath << std::endl
+                  << ">> Model Faces Num: " << asset->GetTriangleNum()
+                  << std::endl;
+    else
+        try {
+            auto mesh = std::make_shared<kouek::Mesh>();
+            mesh->ReadFromFile(modelPath);
+            auto vs = mesh->GetVS();
+            auto &fvs = mesh->GetFVS();
+            auto &fvts = mesh->GetFVTS();
+            auto &fvns = mesh->GetFVNS();
+            std::cout << "Model: " << modelPath << std::endl;
+            std::cout << ">> Model Vertices Num: " << vs.size() << std::endl;
+            std::cout << ">> Model Faces Num: " << fvs.size() << std::endl;
+
+            asset = MeshAsset::Create(
+                vs, {}, Mesh::ToIndices(fvs),
+                fvts.empty() ? StridedSpan<const glm::vec2>()
+                             : mesh->GetVTS(),
+                Mesh::ToIndices(fvts),
+                fvns.empty() ? StridedSpan<const glm::vec3>()
+                             : mesh->GetVNS(),
+                Mesh::ToIndices(fvns), mesh);
+            // Faces laid out by octree leaf, and welded, so that every file
+            // stores a single index per corner
+            if (auto reordered = asset->Reorder(); reordered)
+                asset = reordered;
+            if (!fvts.empty() || !fvns.empty())
+                if (auto welded = asset->Weld(); welded)
+                    asset = welded;
+        } catch (std::exception &exp) {
+            std::cout << "Model: " << modelPath << "loading failed."
+                      << std::endl;
+            std::cout << ">> Error: " << exp.what() << std::endl;
+            return 1;
+        }
+
+    // Build the octree and meshlets, and store them along, or compress
+    // the arrays only, or store faces in pages by octree leaf
+    auto outPath = parser.get<std::string>("o");
+    auto posBits = parser.get<uint32_t>("z");
+    auto t0 = std::chrono::system_clock::now();
+    if (!(parser.get<bool>("p") ? asset->SavePaged(outPath)
+          : posBits == 0        ? asset->Save(outPath)
+                                : asset->SaveCompressed(outPath, posBits))) {
+        std::cout << "Mesh: " << outPath << " saving failed." << std::endl;
+        return 1;
+    }
+    auto t1 = std::chrono::system_clock::now();
+    std::cout << "Mesh: " << outPath << std::endl;
+    std::cout << ">> File Size: "
+              << std::filesystem::file_size(outPath) / 1024 << " KB"
+              << std::endl;
+    std::cout << ">> Duration: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(t1 -
+                                                                       t0)
+                     .count()
+              << " ms" << std::endl;
+
+    // Time opening it as demo and test do
+    t0 = std::chrono::system_clock::now();
+    auto loaded = MeshAsset::Load(outPath);
+    t1 = std::chrono::system_clock::now();
+    if (!loaded) {
+        std::cout << "Mesh: " << outPath << " loading failed." << std::endl;
+        return 1;
+    }
+    std::cout << ">> Load Duration: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(t1 -
+                                                                       t0)
+                     .count()
+              << " ms" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef KOUEK_CMAKE_IN_H
+#define KOUEK_CMAKE_IN_H
+
+#include <string_view>
+
+namespace kouek
+{
+	constexpr std::string_view PROJECT_SOURCE_DIR = "/root/repo";
+}
+
+#endif // !KOUEK_CMAKE_IN_H
@@ -0,0 +1,102 @@
+#ifndef KOUEK_MESH_ASSET_H
+#define KOUEK_MESH_ASSET_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <util/span.hpp>
+
+namespace kouek {
+
+// Geometry with its attributes and spatial index, shared read-only by
+// any number of rasterizers via Rasterizer::SetMeshAsset(). The spatial
+// index is built once, by the first rasterizer needing it. The vectors or
+// borrowed memory must not be modified afterwards, except as
+// Rasterizer::UpdatePositions() allows.
+class MeshAsset {
+  public:
+    virtual ~MeshAsset() {}
+
+    struct AABB {
+        glm::vec3 min, max;
+    };
+
+    // Of faces read on demand from a file written by SavePaged()
+    static constexpr size_t DEFAULT_PAGE_BUDGET = (size_t)256 << 20;
+
+    virtual size_t GetTriangleNum() const = 0;
+    virtual AABB GetAABB() const = 0;
+    // Write the geometry with its spatial index, building it if needed,
+    // to be opened by Load(). Returns false on I/O failure.
+    virtual bool Save(const std::string &path) const = 0;
+    // Write the geometry compactly for slow storage, to be opened by
+    // Load() decoding while reading: positions quantized to posBits per
+    // axis, faces grouped by octree leaf and all arrays entropy coded.
+    // Returns false on I/O failure.
+    virtual bool SaveCompressed(const std::string &path,
+                                uint32_t posBits) const = 0;
+    // Write the spatial index followed by the faces of each octree leaf
+    // as a page of their own, to be opened by Load() for out-of-core
+    // rendering. Returns false on I/O failure.
+    virtual bool SavePaged(const std::string &path) const = 0;
+    // A copy with a vertex per distinct (position, uv, normal) of face
+    // corners, its attributes interleaved, all taken by a single array of
+    // indices, so that each corner is fetched once from one place.
+    // Vertices are numbered in the order faces first use them.
+    // Returns nullptr for a paged asset, or if that takes more memory than
+    // the separate indices, e.g. of faceted models.
+    virtual std::shared_ptr<const MeshAsset> Weld() const = 0;
+    // A copy with the faces of each octree leaf side by side, in the
+    // order of the leaves. In a leaf, patches facing outwards come first,
+    // to reduce overdraw from any view, and faces in a patch are ordered
+    // for a vertex cache. Vertices are numbered in the order faces first
+    // use them. The octree and patches of the asset, built if not yet,
+    // are handed to the copy renumbered, not built again.
+    // Returns nullptr for a paged asset.
+    virtual std::shared_ptr<const MeshAsset> Reorder() const = 0;
+    // A copy keeping its vertices compactly in memory, decoded as
+    // rasterizers fetch them: positions quantized to 16 bits per axis in
+    // the AABB of each run of vertices, normals in 2x16 bits on an
+    // octahedron, or not kept if they are those of faces, and uvs in 16
+    // bits per axis. Its spatial index is built on the positions as
+    // decoded. Returns nullptr for a paged or compact asset.
+    // A compact asset can't be modified, saved, welded or reordered.
+    virtual std::shared_ptr<const MeshAsset> Compact() const = 0;
+
+    static std::shared_ptr<const MeshAsset>
+    Create(std::shared_ptr<std::vector<glm::vec3>> positions,
+           std::shared_ptr<std::vector<glm::vec3>> colors,
+           std::shared_ptr<std::vector<glm::uint>> indices,
+           std::shared_ptr<std::vector<glm::vec2>> uvs = nullptr,
+           std::shared_ptr<std::vector<glm::uint>> uvIndices = nullptr,
+           std::shared_ptr<std::vector<glm::vec3>> norms = nullptr,
+           std::shared_ptr<std::vector<glm::uint>> nIndices = nullptr);
+    // Borrow the arrays in place, as Rasterizer::SetVertexData() does.
+    // The memory must stay valid as long as the asset does, which holding
+    // owner ensures if it is set. Empty colors, uvs or norms are absent.
+    static std::shared_ptr<const MeshAsset>
+    Create(StridedSpan<const glm::vec3> positions,
+           StridedSpan<const glm::vec3> colors,
+           StridedSpan<const glm::uint> indices,
+           StridedSpan<const glm::vec2> uvs,
+           StridedSpan<const glm::uint> uvIndices,
+           StridedSpan<const glm::vec3> norms,
+           StridedSpan<const glm::uint> nIndices,
+           std::shared_ptr<const void> owner);
+    // Map a file written by Save(), using its arrays and spatial index in
+    // place, or decode one written by SaveCompressed().
+    // Of a file written by SavePaged(), only the spatial index is kept in
+    // memory, and the pages of leaves are read as rasterizers reach them,
+    // at most pageBudget bytes of them cached. Only the hierarchical
+    // rasterizer draws such an asset, which can't be modified or saved.
+    // Returns nullptr if it is missing, corrupt or of another format.
+    static std::shared_ptr<const MeshAsset>
+    Load(const std::string &path, size_t pageBudget = DEFAULT_PAGE_BUDGET);
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_MESH_ASSET_H
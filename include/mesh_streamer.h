@@ -0,0 +1,50 @@
+#ifndef KOUEK_MESH_STREAMER_H
+#define KOUEK_MESH_STREAMER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <mesh_asset.h>
+
+namespace kouek {
+
+// Loads a model on a background thread, so that a viewer keeps rendering
+// while it loads. A file written by MeshAsset::SaveCompressed() is handed
+// out in chunks of faces, in octree leaf order, as they are decoded, to be
+// drawn through Rasterizer::AppendTriangles() long before all of it is in.
+// Other formats are handed out only as a whole.
+class MeshStreamer {
+  public:
+    virtual ~MeshStreamer() {}
+
+    // Faces of some octree leaves, indexing positions of their own
+    struct Chunk {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> colors;
+        std::vector<glm::uint> indices;
+    };
+
+    // Take the earliest chunk not taken yet, without blocking.
+    // Returns false if none is ready.
+    virtual bool PopChunk(Chunk &chunk) = 0;
+    // The whole model with its texture data and spatial index, to be
+    // drawn in place of the chunks taken so far. nullptr until loaded.
+    virtual std::shared_ptr<const MeshAsset> GetAsset() const = 0;
+    // Loaded, or failed if GetError() is not empty
+    virtual bool IsDone() const = 0;
+    virtual std::string GetError() const = 0;
+
+    // Start loading a file opened by MeshAsset::Load(), or an OBJ or PLY
+    // model, building its spatial index in the background as well, loaded
+    // from / saved to cacheDir if it is not empty.
+    // Destroying the streamer stops loading.
+    static std::unique_ptr<MeshStreamer>
+    Create(const std::string &path, const std::string &cacheDir = "");
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_MESH_STREAMER_H
@@ -2,10 +2,16 @@
 #define KOUEK_RAS_H
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <mesh_asset.h>
+
+#include <util/pvs.hpp>
+#include <util/span.hpp>
+
 namespace kouek {
 
 class Rasterizer {
@@ -17,11 +23,49 @@ class Rasterizer {
     SetVertexData(std::shared_ptr<std::vector<glm::vec3>> positions,
                   std::shared_ptr<std::vector<glm::vec3>> colors,
                   std::shared_ptr<std::vector<glm::uint>> indices) = 0;
+    // Borrow the vertex data in place, e.g. in a mapped file, an arena or
+    // interleaved vertex structs, instead of sharing vectors. The memory
+    // must stay valid until the vertex data is set again or the rasterizer
+    // is destroyed, which holding owner ensures if it is set. colors may
+    // be empty.
+    virtual void SetVertexData(StridedSpan<const glm::vec3> positions,
+                               StridedSpan<const glm::vec3> colors,
+                               StridedSpan<const glm::uint> indices,
+                               std::shared_ptr<const void> owner) = 0;
+    // Use geometry shared with other rasterizers in place of the vertex
+    // and texture data, so that its spatial index is built only once.
+    // Per-view buffers stay owned by each rasterizer.
+    virtual void SetMeshAsset(std::shared_ptr<const MeshAsset> asset) = 0;
+    // Notify that positions [first, first + num) of the vertex data were
+    // changed in place, e.g. by skinning, since the last SetVertexData().
+    // Cheaper than SetVertexData() when only part of the mesh moves.
+    // On a shared MeshAsset, this affects all rasterizers using it, and
+    // must not overlap any of their Render().
+    virtual void UpdatePositions(size_t first, size_t num) = 0;
+    // Append a chunk of triangles to the vertex data, creating it if none
+    // was set. indices are local to the chunk. colors are used only if
+    // the vertex data has colors. The new faces take the normals of their
+    // planes and uv (0, 0) in the texture data, if there is any, or only
+    // normals if the vertex data is created. Vertex and texture data set
+    // before are copied on the first call, leaving the caller's vectors
+    // and borrowed memory untouched, so later changes to them are no
+    // longer seen, as is a shared MeshAsset.
+    // Visible in the next Render().
+    virtual void AppendTriangles(const std::vector<glm::vec3> &positions,
+                                 const std::vector<glm::vec3> &colors,
+                                 const std::vector<glm::uint> &indices) = 0;
     virtual void
     SetTextureData(std::shared_ptr<std::vector<glm::vec2>> uvs,
                    std::shared_ptr<std::vector<glm::uint>> uvIndices,
                    std::shared_ptr<std::vector<glm::vec3>> norms,
                    std::shared_ptr<std::vector<glm::uint>> nIndices) = 0;
+    // Borrow the texture data in place, as SetVertexData() does.
+    // Empty uvs or norms are absent.
+    virtual void SetTextureData(StridedSpan<const glm::vec2> uvs,
+                                StridedSpan<const glm::uint> uvIndices,
+                                StridedSpan<const glm::vec3> norms,
+                                StridedSpan<const glm::uint> nIndices,
+                                std::shared_ptr<const void> owner) = 0;
     struct LightParam {
         float ambientStrength;
         glm::vec3 ambientColor;
@@ -30,9 +74,44 @@ class Rasterizer {
     };
     virtual void SetLight(const LightParam &param) = 0;
     virtual void SetModel(const glm::mat4 &model) = 0;
+    // Draw the vertex data once per instance, each with its own model
+    // matrix in place of the one set by SetModel(), while storing it once.
+    // Returns the index of the added instance.
+    virtual glm::uint AddInstance(const glm::mat4 &model) = 0;
+    virtual void SetInstanceModel(glm::uint instIdx,
+                                  const glm::mat4 &model) = 0;
+    // Back to drawing the vertex data once with SetModel()'s matrix
+    virtual void ClearInstances() = 0;
     virtual void SetView(const glm::mat4 &view) = 0;
     virtual void SetProjective(const glm::mat4 &proj) = 0;
     virtual void SetRenderSize(const glm::uvec2 &rndrSz) = 0;
+    // Seed occlusion culling with the last frame's depth reprojected to
+    // the current view. Only affects culling, never the final depth.
+    virtual void SetDepthReprojection(bool enable) = 0;
+    // Directory to persist acceleration structures into, so later runs on
+    // the same mesh can skip the build. Empty disables it. Must be set
+    // before the first Render() after SetVertexData().
+    virtual void SetCacheDirectory(const std::string &dir) = 0;
+    // Draw simplified proxies in place of parts of the mesh whose error
+    // projects to at most pxErr pixels on screen. 0 disables it.
+    virtual void SetLODThreshold(float pxErr) = 0;
+    // Cache color and depth sprites of distant parts of the mesh in at most
+    // budget bytes, evicting the least recently used. A sprite is drawn in
+    // place of its part while the direction to it turns by at most angTol
+    // radians and its size on screen changes by at most sizeTol, as a
+    // ratio, since it was captured. 0 budget disables it.
+    virtual void SetImpostorCache(size_t budget, float angTol,
+                                  float sizeTol) = 0;
+    // Restrict occlusion culling to the octree nodes potentially visible
+    // from the camera cell the eye is in. Eyes out of all cells, and sets
+    // made for another octree, restrict nothing. nullptr disables it.
+    // A set holds only what its sampled views saw, so it is lossy: nodes
+    // visible from eyes between samples, or through holes finer than the
+    // sampled resolution, may be dropped.
+    virtual void SetPVS(std::shared_ptr<const PVS> pvs) = 0;
+    // Add the octree nodes passing the Depth Test in the last Render() to
+    // the set of a cell, to precompute a PVS from views sampled in it
+    virtual void RecordPVS(PVS &pvs, size_t cellIdx) = 0;
     virtual const std::vector<glm::u8vec4> &GetColorOutput() = 0;
 };
 
@@ -0,0 +1,97 @@
+#ifndef KOUEK_BVH_H
+#define KOUEK_BVH_H
+
+#include <algorithm>
+
+#include <array>
+#include <stack>
+#include <tuple>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace kouek {
+
+// Binary BVH over a small number of AABBs, e.g. those of instances.
+// Nodes are stored with the 2 children of an inner node contiguous.
+template <typename IdxTy, uint32_t LeafCap> class BVH {
+  public:
+    struct AABB {
+        glm::vec3 min, max;
+    };
+    struct Node {
+        AABB aabb;
+        // inner: children at [first, first + 2) of nodes, num is 0
+        // leaf:  data indices at [first, first + num) of leafIndices
+        IdxTy first;
+        IdxTy num;
+    };
+
+  private:
+    std::vector<Node> nodes;
+    std::vector<IdxTy> leafIndices;
+
+  public:
+    const auto &GetNodes() const { return nodes; }
+    const auto &GetLeafIndices() const { return leafIndices; }
+
+    // Split at the median of the AABB centers along the longest axis
+    void Build(const std::vector<AABB> &aabbs) {
+        nodes.clear();
+        leafIndices.resize(aabbs.size());
+        for (IdxTy i = 0; i < aabbs.size(); ++i)
+            leafIndices[i] = i;
+        if (aabbs.empty())
+            return;
+
+        std::stack<std::tuple<IdxTy, IdxTy, IdxTy>> stk;
+        nodes.emplace_back();
+        stk.emplace(0, aabbs.size(), 0);
+        while (!stk.empty()) {
+            auto [beg, end, nodeIdx] = stk.top();
+            stk.pop();
+
+            AABB aabb = aabbs[leafIndices[beg]];
+            auto ctr = .5f * (aabb.min + aabb.max);
+            AABB ctrAABB{ctr, ctr};
+            for (auto i = beg + 1; i < end; ++i) {
+                auto &o = aabbs[leafIndices[i]];
+                aabb.min = glm::min(aabb.min, o.min);
+                aabb.max = glm::max(aabb.max, o.max);
+                ctr = .5f * (o.min + o.max);
+                ctrAABB.min = glm::min(ctrAABB.min, ctr);
+                ctrAABB.max = glm::max(ctrAABB.max, ctr);
+            }
+            nodes[nodeIdx].aabb = aabb;
+            if (end - beg <= LeafCap) {
+                nodes[nodeIdx].first = beg;
+                nodes[nodeIdx].num = end - beg;
+                continue;
+            }
+
+            auto ext = ctrAABB.max - ctrAABB.min;
+            uint8_t axis = ext.x >= ext.y && ext.x >= ext.z ? 0
+                           : ext.y >= ext.z                 ? 1
+                                                            : 2;
+            auto mid = beg + (end - beg) / 2;
+            std::nth_element(leafIndices.begin() + beg,
+                             leafIndices.begin() + mid,
+                             leafIndices.begin() + end,
+                             [&](IdxTy a, IdxTy b) {
+                                 return aabbs[a].min[axis] + aabbs[a].max[axis] <
+                                        aabbs[b].min[axis] + aabbs[b].max[axis];
+                             });
+
+            auto first = (IdxTy)nodes.size();
+            nodes[nodeIdx].first = first;
+            nodes[nodeIdx].num = 0;
+            nodes.resize(nodes.size() + 2);
+            stk.emplace(beg, mid, first);
+            stk.emplace(mid, end, first + 1);
+        }
+    }
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_BVH_H
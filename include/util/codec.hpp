@@ -0,0 +1,169 @@
+#ifndef KOUEK_CODEC_H
+#define KOUEK_CODEC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <vector>
+
+namespace kouek {
+
+// Signed to unsigned, small magnitudes to small values
+inline uint32_t ZigZag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+inline int32_t UnZigZag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 0x1);
+}
+
+// LEB128, 7 bits per byte
+inline void PutVarint(std::vector<uint8_t> &out, uint32_t v) {
+    while (v >= 0x80) {
+        out.emplace_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.emplace_back((uint8_t)v);
+}
+// Returns nullptr if [itr, end) ends in the middle of a value
+inline const uint8_t *GetVarint(const uint8_t *itr, const uint8_t *end,
+                                uint32_t &v) {
+    v = 0;
+    for (uint8_t shift = 0; itr != end && shift < 35; shift += 7) {
+        auto byte = *itr++;
+        v |= (uint32_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return itr;
+    }
+    return nullptr;
+}
+
+// Order-0 range Asymmetric Numeral System coder of bytes, with a 32-bit
+// state and 12-bit probabilities. Output is the raw size, the frequency
+// table and the coded bytes.
+class RANS {
+  private:
+    static constexpr uint32_t PROB_BITS = 12;
+    static constexpr uint32_t PROB_SCALE = 1 << PROB_BITS;
+    static constexpr uint32_t STATE_LOW = 1 << 23;
+
+  public:
+    static std::vector<uint8_t> Encode(const uint8_t *dat, size_t sz) {
+        std::vector<uint8_t> out(sizeof(uint64_t));
+        uint64_t rawSz = sz;
+        std::memcpy(out.data(), &rawSz, sizeof(rawSz));
+        if (sz == 0)
+            return out;
+
+        // Normalize to PROB_SCALE, keeping present symbols above 0
+        std::array<uint64_t, 256> cnts{};
+        for (size_t i = 0; i < sz; ++i)
+            ++cnts[dat[i]];
+        std::array<uint32_t, 256> freqs{};
+        uint32_t sum = 0;
+        uint8_t maxSym = 0;
+        for (uint32_t s = 0; s < 256; ++s) {
+            if (cnts[s] == 0)
+                continue;
+            freqs[s] = std::max<uint32_t>(
+                1, (uint32_t)(cnts[s] * PROB_SCALE / sz));
+            sum += freqs[s];
+            if (cnts[s] > cnts[maxSym])
+                maxSym = s;
+        }
+        while (sum > PROB_SCALE) {
+            uint8_t s = 0;
+            for (uint32_t t = 1; t < 256; ++t)
+                if (freqs[t] > freqs[s])
+                    s = t;
+            --freqs[s];
+            --sum;
+        }
+        freqs[maxSym] += PROB_SCALE - sum;
+        std::array<uint32_t, 256> starts{};
+        for (uint32_t s = 1; s < 256; ++s)
+            starts[s] = starts[s - 1] + freqs[s - 1];
+        for (uint32_t s = 0; s < 256; ++s) {
+            out.emplace_back((uint8_t)freqs[s]);
+            out.emplace_back((uint8_t)(freqs[s] >> 8));
+        }
+
+        // Encoded backwards, so that decoding runs forwards
+        std::vector<uint8_t> rev;
+        rev.reserve(sz / 2 + 4);
+        uint32_t x = STATE_LOW;
+        for (size_t i = sz; i-- > 0;) {
+            auto s = dat[i];
+            auto xMax = ((STATE_LOW >> PROB_BITS) << 8) * freqs[s];
+            while (x >= xMax) {
+                rev.emplace_back((uint8_t)x);
+                x >>= 8;
+            }
+            x = ((x / freqs[s]) << PROB_BITS) + (x % freqs[s]) + starts[s];
+        }
+        for (uint8_t i = 0; i < 4; ++i) {
+            rev.emplace_back((uint8_t)x);
+            x >>= 8;
+        }
+        out.insert(out.end(), rev.rbegin(), rev.rend());
+        return out;
+    }
+    static std::vector<uint8_t> Encode(const std::vector<uint8_t> &dat) {
+        return Encode(dat.data(), dat.size());
+    }
+
+    // Returns false if [itr, end) is not the output of Encode() of at
+    // most maxSz bytes
+    static bool Decode(const uint8_t *itr, const uint8_t *end,
+                       std::vector<uint8_t> &out, size_t maxSz) {
+        uint64_t rawSz;
+        if (end - itr < (ptrdiff_t)sizeof(rawSz))
+            return false;
+        std::memcpy(&rawSz, itr, sizeof(rawSz));
+        if (rawSz > maxSz)
+            return false;
+        itr += sizeof(rawSz);
+        out.resize(rawSz);
+        if (rawSz == 0)
+            return true;
+        if (end - itr < 512 + 4)
+            return false;
+
+        std::array<uint32_t, 256> freqs, starts;
+        std::array<uint8_t, PROB_SCALE> slot2Syms;
+        uint32_t sum = 0;
+        for (uint32_t s = 0; s < 256; ++s) {
+            freqs[s] = itr[2 * s] | ((uint32_t)itr[2 * s + 1] << 8);
+            starts[s] = sum;
+            sum += freqs[s];
+            if (sum > PROB_SCALE)
+                return false;
+            std::memset(slot2Syms.data() + starts[s], s, freqs[s]);
+        }
+        if (sum != PROB_SCALE)
+            return false;
+        itr += 512;
+
+        uint32_t x = 0;
+        for (uint8_t i = 0; i < 4; ++i)
+            x = (x << 8) | *itr++;
+        for (auto &o : out) {
+            auto slot = x & (PROB_SCALE - 1);
+            auto s = slot2Syms[slot];
+            o = s;
+            x = freqs[s] * (x >> PROB_BITS) + slot - starts[s];
+            while (x < STATE_LOW) {
+                if (itr == end)
+                    return false;
+                x = (x << 8) | *itr++;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_CODEC_H
@@ -0,0 +1,39 @@
+#ifndef KOUEK_HASH_H
+#define KOUEK_HASH_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace kouek {
+
+// 64-bit content hash, 8 bytes per step. Not cryptographic.
+inline uint64_t Hash64(const void *dat, size_t sz, uint64_t seed = 0) {
+    static constexpr uint64_t MUL = 0x9e3779b97f4a7c15ull;
+    auto mix = [](uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    };
+
+    auto bytes = (const uint8_t *)dat;
+    uint64_t h = seed ^ (sz * MUL);
+    size_t i = 0;
+    for (; i + 8 <= sz; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, bytes + i, 8);
+        h = (h ^ mix(w)) * MUL;
+    }
+    if (i < sz) {
+        uint64_t w = 0;
+        std::memcpy(&w, bytes + i, sz - i);
+        h = (h ^ mix(w)) * MUL;
+    }
+    return mix(h);
+}
+
+} // namespace kouek
+
+#endif // !KOUEK_HASH_H
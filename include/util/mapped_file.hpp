@@ -0,0 +1,126 @@
+#ifndef KOUEK_MAPPED_FILE_H
+#define KOUEK_MAPPED_FILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // !NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace kouek {
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+  private:
+    const uint8_t *dat = nullptr;
+    size_t sz = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif // _WIN32
+
+    MappedFile() = default;
+
+  public:
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() {
+#ifdef _WIN32
+        if (dat != nullptr)
+            UnmapViewOfFile(dat);
+        if (mapping != nullptr)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (dat != nullptr)
+            munmap((void *)dat, sz);
+#endif // _WIN32
+    }
+
+    // Returns nullptr if the file can't be opened or is empty
+    static std::shared_ptr<MappedFile> Open(const std::string &path) {
+        std::shared_ptr<MappedFile> mapped(new MappedFile);
+#ifdef _WIN32
+        mapped->file =
+            CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (mapped->file == INVALID_HANDLE_VALUE)
+            return nullptr;
+        LARGE_INTEGER fileSz;
+        if (!GetFileSizeEx(mapped->file, &fileSz) || fileSz.QuadPart == 0)
+            return nullptr;
+        mapped->sz = (size_t)fileSz.QuadPart;
+        mapped->mapping = CreateFileMappingA(mapped->file, nullptr,
+                                             PAGE_READONLY, 0, 0, nullptr);
+        if (mapped->mapping == nullptr)
+            return nullptr;
+        mapped->dat = (const uint8_t *)MapViewOfFile(
+            mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+        if (mapped->dat == nullptr)
+            return nullptr;
+#else
+        auto fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return nullptr;
+        }
+        mapped->sz = (size_t)st.st_size;
+        auto ptr = mmap(nullptr, mapped->sz, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED)
+            return nullptr;
+        mapped->dat = (const uint8_t *)ptr;
+#endif // _WIN32
+        return mapped;
+    }
+
+    const uint8_t *data() const { return dat; }
+    size_t size() const { return sz; }
+};
+
+// Write the file at path with write(os), aside and then renamed over it,
+// so that readers, mapping it or not, never see a partial file. Returns
+// false if any step fails, leaving no temporary file behind.
+template <typename F>
+bool WriteFileAside(const std::string &path, const F &write) {
+    std::error_code ec;
+    auto dir = std::filesystem::path(path).parent_path();
+    if (!dir.empty())
+        std::filesystem::create_directories(dir, ec);
+    auto tmpPath = path + ".tmp";
+    auto written = [&]() {
+        std::ofstream os(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!os.is_open())
+            return false;
+        write(os);
+        os.close();
+        return !os.fail();
+    }();
+    if (written) {
+        std::filesystem::rename(tmpPath, path, ec);
+        if (!ec)
+            return true;
+    }
+    std::filesystem::remove(tmpPath, ec);
+    return false;
+}
+
+} // namespace kouek
+
+#endif // !KOUEK_MAPPED_FILE_H
@@ -1,16 +1,25 @@
 #ifndef KOUEK_MESH_H
 #define KOUEK_MESH_H
 
-#include <fstream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
 #include <array>
 #include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <util/mapped_file.hpp>
+#include <util/parallel.hpp>
+#include <util/span.hpp>
+
 namespace kouek {
 
 class Mesh {
@@ -21,102 +30,95 @@ class Mesh {
     std::vector<glm::uvec3> fvs;
     std::vector<glm::uvec3> fvts;
     std::vector<glm::uvec3> fvns;
+    // vertices in place in a mapped PLY file, instead of in vs
+    std::shared_ptr<MappedFile> mapped;
+    Span<const glm::vec3> mappedVS;
 
   public:
-    const auto &GetVS() const { return vs; }
+    // Valid as long as the mesh is, or is not read again
+    Span<const glm::vec3> GetVS() const {
+        return mapped ? mappedVS : Span<const glm::vec3>(vs);
+    }
     const auto &GetVTS() const { return vts; }
     const auto &GetVNS() const { return vns; }
     const auto &GetFVS() const { return fvs; }
     const auto &GetFVTS() const { return fvts; }
     const auto &GetFVNS() const { return fvns; }
+    // Faces as a flat array of indices, to borrow without copying
+    static StridedSpan<const glm::uint>
+    ToIndices(const std::vector<glm::uvec3> &fs) {
+        static_assert(sizeof(glm::uvec3) == 3 * sizeof(glm::uint));
+        return {fs.empty() ? nullptr : &fs[0][0], fs.size() * 3};
+    }
+    // Parse the file mapped into memory, split at line boundaries into
+    // chunks parsed in parallel. Negative indices count back from the
+    // last element defined before the face, polygons are fanned out.
+    // PLY files, told by their magic, are read by readPLY() instead.
     void ReadFromFile(const std::string &path, bool swapXYZ = false) {
         Clear();
 
-        using namespace std;
-        ifstream in(path.c_str());
-
-        if (!in.is_open())
+        auto mapped = MappedFile::Open(path);
+        if (!mapped)
             throw std::runtime_error(
-                string(path) + " is NOT a valid path. Load model failed.");
-
-        string buf;
-        while (getline(in, buf)) {
-            if (buf[0] == 'v' && buf[1] == ' ') {
-                double x, y, z;
-                sscanf(buf.c_str() + 2, "%lf%lf%lf", &x, &y, &z);
-                if (swapXYZ)
-                    vs.emplace_back(z, x, y);
-                else
-                    vs.emplace_back(x, y, z);
-            } else if (buf[0] == 'v' && buf[1] == 't' && buf[2] == ' ') {
-                double x, y;
-                sscanf(buf.c_str() + 3, "%lf%lf", &x, &y);
-                vts.emplace_back(x, y);
-            } else if (buf[0] == 'v' && buf[1] == 'n' && buf[2] == ' ') {
-                double x, y, z;
-                sscanf(buf.c_str() + 3, "%lf%lf%lf", &x, &y, &z);
-                if (swapXYZ)
-                    vns.emplace_back(z, x, y);
-                else
-                    vns.emplace_back(x, y, z);
-            } else if (buf[0] == 'f' && buf[1] == ' ') {
-                bool hasUV = false, hasN = false;
-                std::array<uint32_t, 4> vIds{0, 0, 0, 0};
-                std::array<uint32_t, 4> tIds{0, 0, 0, 0};
-                std::array<uint32_t, 4> nIds{0, 0, 0, 0};
-
-                sscanf(buf.c_str() + 2, "%d/%d/%d", &vIds[0],
-                                  &tIds[0], &nIds[0]);
-                if (tIds[0] != 0)
-                    hasUV = true;
-                if (nIds[0] != 0)
-                    hasN = true;
-                auto spIdx = buf.find(' ', 2);
-                sscanf(buf.c_str() + spIdx + 1, "%d/%d/%d", &vIds[1], &tIds[1],
-                       &nIds[1]);
-                spIdx = buf.find(' ', spIdx + 1);
-                sscanf(buf.c_str() + spIdx + 1, "%d/%d/%d", &vIds[2], &tIds[2],
-                       &nIds[2]);
-                spIdx = buf.find(' ', spIdx + 1);
-
-                bool isQuad = false;
-                if (spIdx < buf.size() && buf[spIdx + 1] != '\0') {
-                    sscanf(buf.c_str() + spIdx + 1, "%d/%d/%d", &vIds[3],
-                           &tIds[3], &nIds[3]);
-                    isQuad = true;
-                }
+                path + " is NOT a valid path. Load model failed.");
+        if (mapped->size() >= 4 &&
+            std::memcmp(mapped->data(), "ply", 3) == 0 &&
+            (mapped->data()[3] == '\n' || mapped->data()[3] == '\r')) {
+            readPLY(mapped, swapXYZ);
+            return;
+        }
 
-                for (uint8_t i = 0; i < 4; ++i) {
-                    --vIds[i];
-                    --tIds[i];
-                    --nIds[i];
-                }
+        auto txt = (const char *)mapped->data();
+        auto txtSz = mapped->size();
+        std::vector<Chunk> chunks(GetThreadNum());
+        ParallelFor(txtSz, [&](size_t beg, size_t end, uint32_t chunkIdx) {
+            // Own the lines starting in [beg, end)
+            auto toLineStart = [&](size_t pos) {
+                while (pos != 0 && pos < txtSz && txt[pos - 1] != '\n')
+                    ++pos;
+                return pos;
+            };
+            parseChunk(chunks[chunkIdx], txt + toLineStart(beg),
+                       txt + toLineStart(end), swapXYZ);
+        });
 
-                fvs.emplace_back(vIds[0], vIds[1], vIds[2]);
-                if (hasUV)
-                    fvts.emplace_back(tIds[0], tIds[1], tIds[2]);
-                if (hasN)
-                    fvns.emplace_back(nIds[0], nIds[1], nIds[2]);
-                if (isQuad) {
-                    fvs.emplace_back(vIds[0], vIds[2], vIds[3]);
-                    if (hasUV)
-                        fvts.emplace_back(tIds[0], tIds[2], tIds[3]);
-                    if (hasN)
-                        fvns.emplace_back(nIds[0], nIds[2], nIds[3]);
-                }
-            }
+        // Offsets of chunks in the merged arrays
+        std::array<size_t, 6> nums{0, 0, 0, 0, 0, 0};
+        for (auto &chk : chunks) {
+            chk.offs = nums;
+            nums[0] += chk.vs.size();
+            nums[1] += chk.vts.size();
+            nums[2] += chk.vns.size();
+            nums[3] += chk.fvs.size();
+            nums[4] += chk.fvts.size();
+            nums[5] += chk.fvns.size();
         }
-        in.close();
+        vs.resize(nums[0]);
+        vts.resize(nums[1]);
+        vns.resize(nums[2]);
+        fvs.resize(nums[3]);
+        fvts.resize(nums[4]);
+        fvns.resize(nums[5]);
+        std::vector<uint8_t> valids(chunks.size(), 1);
+        ParallelFor(chunks.size(), [&](size_t beg, size_t end, uint32_t) {
+            for (auto chkIdx = beg; chkIdx < end; ++chkIdx)
+                valids[chkIdx] = mergeChunk(chunks[chkIdx]) ? 1 : 0;
+        });
 
         if (vs.empty() || fvs.empty())
             throw std::runtime_error(
                 "File has no vertices or faces. Load model failed.");
+        if (std::find(valids.begin(), valids.end(), 0) != valids.end())
+            throw std::runtime_error(
+                "File has faces indexing out of range. Load model failed.");
 
         if (fvns.empty())
             generateNorms();
     }
 
     inline void Clear() {
+        mapped.reset();
+        mappedVS = Span<const glm::vec3>();
         vs.clear();
         vs.shrink_to_fit();
         vts.clear();
@@ -132,7 +134,523 @@ class Mesh {
     }
 
   private:
+    // Results of a chunk of lines. Relative indices are resolved within
+    // the chunk, the offsets of elements in preceding chunks are added
+    // to those listed in rels when merged.
+    struct Chunk {
+        std::vector<glm::vec3> vs;
+        std::vector<glm::vec2> vts;
+        std::vector<glm::vec3> vns;
+        std::vector<glm::uvec3> fvs;
+        std::vector<glm::uvec3> fvts;
+        std::vector<glm::uvec3> fvns;
+        // by index stream, as face index * 3 + corner
+        std::array<std::vector<size_t>, 3> rels;
+        std::array<size_t, 6> offs;
+    };
+
+    static const char *skipSpaces(const char *itr, const char *end) {
+        while (itr != end && (*itr == ' ' || *itr == '\t' || *itr == '\r'))
+            ++itr;
+        return itr;
+    }
+    template <glm::length_t N>
+    static const char *parseFloats(const char *itr, const char *end,
+                                   glm::vec<N, float> &v) {
+        for (glm::length_t i = 0; i < N; ++i) {
+            itr = skipSpaces(itr, end);
+            if (itr != end && *itr == '+')
+                ++itr;
+            v[i] = 0.f;
+            itr = std::from_chars(itr, end, v[i]).ptr;
+        }
+        return itr;
+    }
+
+    static void parseChunk(Chunk &chk, const char *itr, const char *end,
+                           bool swapXYZ) {
+        // Corners of a polygon, 0 for a missing index
+        std::vector<std::array<int64_t, 3>> corners;
+        while (itr != end) {
+            auto lineEnd = (const char *)std::memchr(itr, '\n', end - itr);
+            if (lineEnd == nullptr)
+                lineEnd = end;
+            auto lineSz = lineEnd - itr;
+
+            if (lineSz > 1 && itr[0] == 'v' && itr[1] == ' ') {
+                glm::vec3 v;
+                parseFloats(itr + 2, lineEnd, v);
+                if (swapXYZ)
+                    chk.vs.emplace_back(v.z, v.x, v.y);
+                else
+                    chk.vs.emplace_back(v);
+            } else if (lineSz > 2 && itr[0] == 'v' && itr[1] == 't' &&
+                       itr[2] == ' ') {
+                glm::vec2 v;
+                parseFloats(itr + 3, lineEnd, v);
+                chk.vts.emplace_back(v);
+            } else if (lineSz > 2 && itr[0] == 'v' && itr[1] == 'n' &&
+                       itr[2] == ' ') {
+                glm::vec3 v;
+                parseFloats(itr + 3, lineEnd, v);
+                if (swapXYZ)
+                    chk.vns.emplace_back(v.z, v.x, v.y);
+                else
+                    chk.vns.emplace_back(v);
+            } else if (lineSz > 1 && itr[0] == 'f' && itr[1] == ' ') {
+                corners.clear();
+                auto cItr = skipSpaces(itr + 2, lineEnd);
+                while (cItr != lineEnd) {
+                    // v, v/vt, v//vn or v/vt/vn
+                    auto &corner = corners.emplace_back();
+                    corner = {0, 0, 0};
+                    for (uint8_t i = 0; i < 3; ++i) {
+                        cItr = std::from_chars(cItr, lineEnd, corner[i]).ptr;
+                        if (cItr == lineEnd || *cItr != '/')
+                            break;
+                        ++cItr;
+                    }
+                    while (cItr != lineEnd && *cItr != ' ' && *cItr != '\t' &&
+                           *cItr != '\r')
+                        ++cItr;
+                    cItr = skipSpaces(cItr, lineEnd);
+                }
+                if (corners.size() >= 3)
+                    addPolygon(chk, corners);
+            }
+
+            itr = lineEnd == end ? end : lineEnd + 1;
+        }
+    }
+
+    static void addPolygon(Chunk &chk,
+                           const std::vector<std::array<int64_t, 3>> &corners) {
+        std::array<size_t, 3> nums{chk.vs.size(), chk.vts.size(),
+                                   chk.vns.size()};
+        std::array<std::vector<glm::uvec3> *, 3> fs{&chk.fvs, &chk.fvts,
+                                                     &chk.fvns};
+        for (uint8_t s = 0; s < 3; ++s) {
+            // As in the first corner
+            if (corners[0][s] == 0)
+                continue;
+            auto toIdx = [&](size_t c, size_t fIdx, uint8_t t) {
+                auto idx = corners[c][s];
+                if (idx > 0)
+                    return (glm::uint)(idx - 1);
+                // Wrap around below the chunk, fixed by the offset added
+                if (idx < 0)
+                    chk.rels[s].emplace_back(fIdx * 3 + t);
+                return (glm::uint)((int64_t)nums[s] + idx);
+            };
+            for (size_t c = 2; c < corners.size(); ++c) {
+                auto fIdx = fs[s]->size();
+                fs[s]->emplace_back(toIdx(0, fIdx, 0), toIdx(c - 1, fIdx, 1),
+                                    toIdx(c, fIdx, 2));
+            }
+        }
+    }
+
+    bool mergeChunk(const Chunk &chk) {
+        std::copy(chk.vs.begin(), chk.vs.end(), vs.begin() + chk.offs[0]);
+        std::copy(chk.vts.begin(), chk.vts.end(), vts.begin() + chk.offs[1]);
+        std::copy(chk.vns.begin(), chk.vns.end(), vns.begin() + chk.offs[2]);
+
+        bool valid = true;
+        std::array<const std::vector<glm::uvec3> *, 3> srcs{
+            &chk.fvs, &chk.fvts, &chk.fvns};
+        std::array<std::vector<glm::uvec3> *, 3> dsts{&fvs, &fvts, &fvns};
+        std::array<size_t, 3> elemNums{vs.size(), vts.size(), vns.size()};
+        for (uint8_t s = 0; s < 3; ++s) {
+            auto dst = dsts[s]->begin() + chk.offs[3 + s];
+            std::copy(srcs[s]->begin(), srcs[s]->end(), dst);
+            for (auto rel : chk.rels[s])
+                dst[rel / 3][rel % 3] += (glm::uint)chk.offs[s];
+            for (auto itr = dst; itr != dst + srcs[s]->size(); ++itr)
+                for (uint8_t t = 0; t < 3; ++t)
+                    valid &= (*itr)[t] < elemNums[s];
+        }
+        return valid;
+    }
+
+    enum class PLYType : uint8_t {
+        None,
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Float32,
+        Float64
+    };
+    struct PLYProperty {
+        std::string name;
+        PLYType type;
+        // of the count of a list property, None if it is not a list
+        PLYType cntType;
+    };
+    struct PLYElement {
+        std::string name;
+        size_t num;
+        std::vector<PLYProperty> props;
+    };
+    enum class PLYFormat : uint8_t { ASCII, LittleEndian, BigEndian };
+
+    static PLYType toPLYType(const std::string &name) {
+        static const std::array<std::pair<const char *, PLYType>, 16>
+            NAME_TYPES{{{"char", PLYType::Int8},
+                        {"int8", PLYType::Int8},
+                        {"uchar", PLYType::UInt8},
+                        {"uint8", PLYType::UInt8},
+                        {"short", PLYType::Int16},
+                        {"int16", PLYType::Int16},
+                        {"ushort", PLYType::UInt16},
+                        {"uint16", PLYType::UInt16},
+                        {"int", PLYType::Int32},
+                        {"int32", PLYType::Int32},
+                        {"uint", PLYType::UInt32},
+                        {"uint32", PLYType::UInt32},
+                        {"float", PLYType::Float32},
+                        {"float32", PLYType::Float32},
+                        {"double", PLYType::Float64},
+                        {"float64", PLYType::Float64}}};
+        for (auto &[typeName, type] : NAME_TYPES)
+            if (name == typeName)
+                return type;
+        return PLYType::None;
+    }
+    static uint8_t sizeOf(PLYType type) {
+        switch (type) {
+        case PLYType::Int8:
+        case PLYType::UInt8:
+            return 1;
+        case PLYType::Int16:
+        case PLYType::UInt16:
+            return 2;
+        case PLYType::Int32:
+        case PLYType::UInt32:
+        case PLYType::Float32:
+            return 4;
+        case PLYType::Float64:
+            return 8;
+        default:
+            return 0;
+        }
+    }
+    static bool isHostLittleEndian() {
+        uint16_t one = 1;
+        uint8_t low;
+        std::memcpy(&low, &one, 1);
+        return low == 1;
+    }
+    template <typename T>
+    static double readBinary(const uint8_t *itr, bool swapBytes) {
+        std::array<uint8_t, sizeof(T)> bytes;
+        std::memcpy(bytes.data(), itr, sizeof(T));
+        if (swapBytes)
+            std::reverse(bytes.begin(), bytes.end());
+        T v;
+        std::memcpy(&v, bytes.data(), sizeof(T));
+        return (double)v;
+    }
+    static double readBinary(const uint8_t *itr, PLYType type,
+                             bool swapBytes) {
+        switch (type) {
+        case PLYType::Int8:
+            return (int8_t)*itr;
+        case PLYType::UInt8:
+            return *itr;
+        case PLYType::Int16:
+            return readBinary<int16_t>(itr, swapBytes);
+        case PLYType::UInt16:
+            return readBinary<uint16_t>(itr, swapBytes);
+        case PLYType::Int32:
+            return readBinary<int32_t>(itr, swapBytes);
+        case PLYType::UInt32:
+            return readBinary<uint32_t>(itr, swapBytes);
+        case PLYType::Float32:
+            return readBinary<float>(itr, swapBytes);
+        case PLYType::Float64:
+            return readBinary<double>(itr, swapBytes);
+        default:
+            return 0.;
+        }
+    }
+
+    // Values of the body of a PLY file in order, ASCII or binary
+    struct PLYReader {
+        const uint8_t *itr;
+        const uint8_t *end;
+        PLYFormat fmt;
+        bool swapBytes;
+
+        double Read(PLYType type) {
+            if (fmt == PLYFormat::ASCII) {
+                while (itr != end && (*itr == ' ' || *itr == '\t' ||
+                                      *itr == '\r' || *itr == '\n'))
+                    ++itr;
+                double v;
+                auto [ptr, ec] = std::from_chars((const char *)itr,
+                                                 (const char *)end, v);
+                if (ec != std::errc())
+                    throw std::runtime_error(
+                        "File has invalid PLY data. Load model failed.");
+                itr = (const uint8_t *)ptr;
+                return v;
+            }
+            Require(sizeOf(type));
+            auto v = readBinary(itr, type, swapBytes);
+            itr += sizeOf(type);
+            return v;
+        }
+        void Skip(const PLYProperty &prop) {
+            if (prop.cntType == PLYType::None) {
+                Read(prop.type);
+                return;
+            }
+            auto cnt = (size_t)Read(prop.cntType);
+            if (fmt != PLYFormat::ASCII) {
+                Require(cnt * sizeOf(prop.type));
+                itr += cnt * sizeOf(prop.type);
+                return;
+            }
+            for (size_t i = 0; i < cnt; ++i)
+                Read(prop.type);
+        }
+        void Require(size_t sz) const {
+            if ((size_t)(end - itr) < sz)
+                throw std::runtime_error(
+                    "File is truncated. Load model failed.");
+        }
+    };
+
+    // Vertex positions, normals and texture coordinates, and polygons of
+    // vertex indices, which index normals and texture coordinates too.
+    // Other elements and properties are skipped.
+    void readPLY(std::shared_ptr<MappedFile> file, bool swapXYZ) {
+        auto dat = file->data();
+        auto end = dat + file->size();
+        PLYReader rdr{dat, end, PLYFormat::ASCII, false};
+        std::vector<PLYElement> elems;
+        auto formatted = false;
+        auto headerEnded = false;
+        while (rdr.itr != end && !headerEnded) {
+            auto lineEnd =
+                (const uint8_t *)std::memchr(rdr.itr, '\n', end - rdr.itr);
+            if (lineEnd == nullptr)
+                lineEnd = end;
+            std::istringstream line(
+                std::string((const char *)rdr.itr, (const char *)lineEnd));
+            rdr.itr = lineEnd == end ? end : lineEnd + 1;
+
+            std::string key;
+            line >> key;
+            if (key == "format") {
+                std::string fmt;
+                line >> fmt;
+                formatted = true;
+                if (fmt == "ascii")
+                    rdr.fmt = PLYFormat::ASCII;
+                else if (fmt == "binary_little_endian")
+                    rdr.fmt = PLYFormat::LittleEndian;
+                else if (fmt == "binary_big_endian")
+                    rdr.fmt = PLYFormat::BigEndian;
+                else
+                    formatted = false;
+            } else if (key == "element") {
+                auto &elem = elems.emplace_back();
+                line >> elem.name >> elem.num;
+                if (!line)
+                    formatted = false;
+            } else if (key == "property" && !elems.empty()) {
+                auto &prop = elems.back().props.emplace_back();
+                std::string type;
+                line >> type;
+                prop.cntType = PLYType::None;
+                if (type == "list") {
+                    line >> type;
+                    prop.cntType = toPLYType(type);
+                    line >> type;
+                    if (prop.cntType == PLYType::None)
+                        formatted = false;
+                }
+                prop.type = toPLYType(type);
+                line >> prop.name;
+                if (!line || prop.type == PLYType::None)
+                    formatted = false;
+            } else if (key == "end_header")
+                headerEnded = true;
+        }
+        if (!formatted || !headerEnded)
+            throw std::runtime_error(
+                "File has an invalid PLY header. Load model failed.");
+        rdr.swapBytes =
+            rdr.fmt != PLYFormat::ASCII &&
+            (rdr.fmt == PLYFormat::LittleEndian) != isHostLittleEndian();
+
+        for (auto &elem : elems)
+            if (elem.name == "vertex")
+                readPLYVertices(elem, rdr, file, swapXYZ);
+            else if (elem.name == "face")
+                readPLYFaces(elem, rdr);
+            else
+                for (size_t i = 0; i < elem.num; ++i)
+                    for (auto &prop : elem.props)
+                        rdr.Skip(prop);
+
+        auto vNum = GetVS().size();
+        if (vNum == 0 || fvs.empty())
+            throw std::runtime_error(
+                "File has no vertices or faces. Load model failed.");
+        for (auto &idx3 : fvs)
+            if (idx3[0] >= vNum || idx3[1] >= vNum || idx3[2] >= vNum)
+                throw std::runtime_error("File has faces indexing out of "
+                                         "range. Load model failed.");
+        if (!vts.empty())
+            fvts = fvs;
+        if (!vns.empty())
+            fvns = fvs;
+        else
+            generateNorms();
+    }
+
+    void readPLYVertices(const PLYElement &elem, PLYReader &rdr,
+                         const std::shared_ptr<MappedFile> &file,
+                         bool swapXYZ) {
+        auto findProp = [&](std::initializer_list<const char *> names) {
+            for (size_t p = 0; p < elem.props.size(); ++p)
+                for (auto name : names)
+                    if (elem.props[p].name == name &&
+                        elem.props[p].cntType == PLYType::None)
+                        return (int)p;
+            return -1;
+        };
+        std::array<int, 3> posProps{findProp({"x"}), findProp({"y"}),
+                                    findProp({"z"})};
+        std::array<int, 3> nProps{findProp({"nx"}), findProp({"ny"}),
+                                  findProp({"nz"})};
+        std::array<int, 2> uvProps{findProp({"u", "s", "texture_u"}),
+                                   findProp({"v", "t", "texture_v"})};
+        auto has = [](const auto &props) {
+            return std::find(props.begin(), props.end(), -1) == props.end();
+        };
+        if (!has(posProps))
+            throw std::runtime_error(
+                "File has vertices without positions. Load model failed.");
+
+        auto fixedSz = rdr.fmt != PLYFormat::ASCII &&
+                       std::all_of(elem.props.begin(), elem.props.end(),
+                                   [](auto &prop) {
+                                       return prop.cntType == PLYType::None;
+                                   });
+        if (!fixedSz) {
+            // One record after another
+            std::vector<double> vals(elem.props.size());
+            vs.resize(elem.num);
+            vns.resize(has(nProps) ? elem.num : 0);
+            vts.resize(has(uvProps) ? elem.num : 0);
+            for (size_t v = 0; v < elem.num; ++v) {
+                for (size_t p = 0; p < elem.props.size(); ++p)
+                    if (elem.props[p].cntType == PLYType::None)
+                        vals[p] = rdr.Read(elem.props[p].type);
+                    else
+                        rdr.Skip(elem.props[p]);
+                assignPLYVertex(v, swapXYZ, posProps, nProps, uvProps,
+                                [&](int p) { return vals[p]; });
+            }
+            return;
+        }
+
+        // Records of the same size, in place if as glm::vec3
+        std::vector<size_t> offs(elem.props.size());
+        size_t stride = 0;
+        for (size_t p = 0; p < elem.props.size(); ++p) {
+            offs[p] = stride;
+            stride += sizeOf(elem.props[p].type);
+        }
+        rdr.Require(stride * elem.num);
+        auto recs = rdr.itr;
+        rdr.itr += stride * elem.num;
+        auto isF32 = [&](int p) {
+            return elem.props[p].type == PLYType::Float32;
+        };
+        if (!rdr.swapBytes && !swapXYZ && stride == sizeof(glm::vec3) &&
+            posProps == std::array<int, 3>{0, 1, 2} && isF32(0) &&
+            isF32(1) && isF32(2) &&
+            (uintptr_t)recs % alignof(glm::vec3) == 0) {
+            mapped = file;
+            mappedVS =
+                Span<const glm::vec3>((const glm::vec3 *)recs, elem.num);
+            return;
+        }
+        vs.resize(elem.num);
+        vns.resize(has(nProps) ? elem.num : 0);
+        vts.resize(has(uvProps) ? elem.num : 0);
+        ParallelFor(elem.num, [&](size_t beg, size_t end, uint32_t) {
+            for (auto v = beg; v < end; ++v) {
+                auto rec = recs + v * stride;
+                assignPLYVertex(v, swapXYZ, posProps, nProps, uvProps,
+                                [&](int p) {
+                                    return readBinary(rec + offs[p],
+                                                      elem.props[p].type,
+                                                      rdr.swapBytes);
+                                });
+            }
+        });
+    }
+    template <typename ReadTy>
+    void assignPLYVertex(size_t v, bool swapXYZ,
+                         const std::array<int, 3> &posProps,
+                         const std::array<int, 3> &nProps,
+                         const std::array<int, 2> &uvProps, ReadTy read) {
+        auto toVec3 = [&](const std::array<int, 3> &props) {
+            glm::vec3 xyz{read(props[0]), read(props[1]), read(props[2])};
+            return swapXYZ ? glm::vec3{xyz.z, xyz.x, xyz.y} : xyz;
+        };
+        vs[v] = toVec3(posProps);
+        if (!vns.empty())
+            vns[v] = toVec3(nProps);
+        if (!vts.empty())
+            vts[v] = glm::vec2{read(uvProps[0]), read(uvProps[1])};
+    }
+
+    void readPLYFaces(const PLYElement &elem, PLYReader &rdr) {
+        auto idxsItr =
+            std::find_if(elem.props.begin(), elem.props.end(), [](auto &prop) {
+                return prop.cntType != PLYType::None &&
+                       (prop.name == "vertex_indices" ||
+                        prop.name == "vertex_index");
+            });
+        if (idxsItr == elem.props.end())
+            throw std::runtime_error(
+                "File has faces without vertex indices. Load model failed.");
+        auto &idxsProp = *idxsItr;
+
+        fvs.reserve(fvs.size() + elem.num);
+        std::vector<glm::uint> corners;
+        for (size_t f = 0; f < elem.num; ++f)
+            for (auto &prop : elem.props) {
+                if (&prop != &idxsProp) {
+                    rdr.Skip(prop);
+                    continue;
+                }
+                auto cnt = (size_t)rdr.Read(prop.cntType);
+                corners.resize(cnt);
+                for (auto &corner : corners) {
+                    // Negative ones to out of range
+                    auto idx = rdr.Read(prop.type);
+                    corner = idx < 0. || idx >= (double)std::numeric_limits<
+                                                    glm::uint>::max()
+                                 ? std::numeric_limits<glm::uint>::max()
+                                 : (glm::uint)idx;
+                }
+                for (size_t c = 2; c < cnt; ++c)
+                    fvs.emplace_back(corners[0], corners[c - 1], corners[c]);
+            }
+    }
+
     void generateNorms() {
+        auto vs = GetVS();
         for (size_t faceIdx = 0; faceIdx < fvs.size(); ++faceIdx) {
             const auto &vIdx3 = fvs[faceIdx];
             const auto &v0 = vs[vIdx3[1]] - vs[vIdx3[0]];
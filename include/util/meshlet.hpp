@@ -0,0 +1,411 @@
+#ifndef KOUEK_MESHLET_H
+#define KOUEK_MESHLET_H
+
+#include <algorithm>
+#include <cmath>
+
+#include <array>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <util/parallel.hpp>
+#include <util/span.hpp>
+
+namespace kouek {
+
+// Clusters of adjacent triangles, built per group of faces (e.g. per
+// octree leaf), each bounded as a whole for culling. Triangles index the
+// vertices of their meshlet with 8-bit local indices, so that vertices
+// shared inside a meshlet are processed once.
+template <typename IdxTy, uint32_t MaxVertNum, uint32_t MaxTriNum>
+class Meshlets {
+    static_assert(MaxVertNum <= 256, "Local indices are 8-bit");
+
+  public:
+    struct AABB {
+        glm::vec3 min, max;
+    };
+    struct Meshlet {
+        AABB aabb;
+        // bounding sphere
+        glm::vec3 ctr;
+        float radius;
+        // all face normals are within acos(coneCos) of coneAxis,
+        // no cone culling if coneCos <= 0
+        glm::vec3 coneAxis;
+        float coneCos;
+        // vertices at [vertFirst, vertFirst + vertNum) of verts,
+        // triangles at [triFirst, triFirst + triNum) of faces and tris
+        IdxTy vertFirst;
+        IdxTy triFirst;
+        uint16_t vertNum;
+        uint16_t triNum;
+    };
+    // meshlets at [first, first + num) of meshlets
+    struct Group {
+        IdxTy first;
+        IdxTy num;
+    };
+
+    static constexpr uint32_t MAX_VERT_NUM = MaxVertNum;
+    static constexpr uint32_t MAX_TRI_NUM = MaxTriNum;
+
+  private:
+    struct Storage {
+        std::vector<Meshlet> meshlets;
+        // global vertex indices
+        std::vector<IdxTy> verts;
+        // global face indices, and their local vertex indices
+        std::vector<IdxTy> faces;
+        std::vector<std::array<uint8_t, 3>> tris;
+    };
+
+    std::vector<Group> groups;
+    Storage storage;
+    // meshlets no longer referenced by any group
+    size_t garbageNum = 0;
+
+  public:
+    const auto &GetGroups() const { return groups; }
+    const auto &GetMeshlets() const { return storage.meshlets; }
+    const auto &GetVertices() const { return storage.verts; }
+    const auto &GetFaces() const { return storage.faces; }
+    const auto &GetTriangles() const { return storage.tris; }
+
+    // Build the meshlets of groups [0, groupNum) in parallel, where
+    // getFaces(groupIdx) returns the Span of face indices of the group
+    template <typename F>
+    void Build(IdxTy groupNum, const F &getFaces,
+               StridedSpan<const glm::uint> indices,
+               StridedSpan<const glm::vec3> positions) {
+        groups.assign(groupNum, Group{0, 0});
+        storage = Storage();
+        garbageNum = 0;
+
+        std::vector<Storage> chunks(std::min<size_t>(GetThreadNum(),
+                                                     std::max<IdxTy>(
+                                                         groupNum, 1)));
+        ParallelFor(groupNum, [&](size_t beg, size_t end, uint32_t chunkIdx) {
+            auto &chunk = chunks[chunkIdx];
+            for (auto g = (IdxTy)beg; g < end; ++g) {
+                groups[g].first = chunk.meshlets.size();
+                buildGroup(chunk, getFaces(g), indices, positions);
+                groups[g].num = chunk.meshlets.size() - groups[g].first;
+            }
+        });
+
+        // Chunks cover contiguous groups, concatenate them in order
+        IdxTy g = 0;
+        for (uint32_t c = 0; c < chunks.size(); ++c) {
+            auto &chunk = chunks[c];
+            auto mOffs = (IdxTy)storage.meshlets.size();
+            auto vOffs = (IdxTy)storage.verts.size();
+            auto tOffs = (IdxTy)storage.faces.size();
+            for (auto m : chunk.meshlets) {
+                m.vertFirst += vOffs;
+                m.triFirst += tOffs;
+                storage.meshlets.emplace_back(m);
+            }
+            storage.verts.insert(storage.verts.end(), chunk.verts.begin(),
+                                 chunk.verts.end());
+            storage.faces.insert(storage.faces.end(), chunk.faces.begin(),
+                                 chunk.faces.end());
+            storage.tris.insert(storage.tris.end(), chunk.tris.begin(),
+                                chunk.tris.end());
+            for (auto end = (IdxTy)((size_t)groupNum * (c + 1) /
+                                    chunks.size());
+                 g < end; ++g)
+                groups[g].first += mOffs;
+        }
+    }
+    // Take meshlets built before, e.g. stored along with the mesh
+    void Assign(Span<const Group> groups, Span<const Meshlet> meshlets,
+                Span<const IdxTy> verts, Span<const IdxTy> faces,
+                Span<const std::array<uint8_t, 3>> tris) {
+        this->groups.assign(groups.begin(), groups.end());
+        storage.meshlets.assign(meshlets.begin(), meshlets.end());
+        storage.verts.assign(verts.begin(), verts.end());
+        storage.faces.assign(faces.begin(), faces.end());
+        storage.tris.assign(tris.begin(), tris.end());
+        garbageNum = storage.meshlets.size();
+        for (auto &group : this->groups)
+            garbageNum -= group.num;
+    }
+    // Update the meshlets of group groupIdx only, after its faces or
+    // their positions changed. Faces left are removed from their
+    // meshlets and faces joined form new ones, so the work is bound by the
+    // faces moved, until the group is fragmented enough to be rebuilt.
+    void Rebuild(IdxTy groupIdx, Span<const IdxTy> groupFaces,
+                 StridedSpan<const glm::uint> indices,
+                 StridedSpan<const glm::vec3> positions) {
+        auto &group = groups[groupIdx];
+        std::vector<IdxTy> currFaces(groupFaces.begin(), groupFaces.end());
+        std::sort(currFaces.begin(), currFaces.end());
+        std::vector<bool> kepts(currFaces.size(), false);
+
+        auto keptNum = group.first;
+        for (auto i = group.first; i < group.first + group.num; ++i) {
+            auto m = storage.meshlets[i];
+            uint16_t triNum = 0;
+            for (auto t = m.triFirst; t < m.triFirst + m.triNum; ++t) {
+                auto itr = std::lower_bound(currFaces.begin(), currFaces.end(),
+                                            storage.faces[t]);
+                if (itr == currFaces.end() || *itr != storage.faces[t])
+                    continue;
+                kepts[itr - currFaces.begin()] = true;
+                storage.faces[m.triFirst + triNum] = storage.faces[t];
+                storage.tris[m.triFirst + triNum] = storage.tris[t];
+                ++triNum;
+            }
+            if (triNum == 0) {
+                ++garbageNum;
+                continue;
+            }
+            m.triNum = triNum;
+            genBounds(m, storage, positions);
+            storage.meshlets[keptNum++] = m;
+        }
+        group.num = keptNum - group.first;
+
+        std::vector<IdxTy> newFaces;
+        for (IdxTy i = 0; i < currFaces.size(); ++i)
+            if (!kepts[i])
+                newFaces.emplace_back(currFaces[i]);
+        if (!newFaces.empty()) {
+            if (group.num + newFaces.size() / MaxTriNum + 1 >
+                2 * (currFaces.size() / MaxTriNum + 1)) {
+                garbageNum += group.num;
+                group.first = storage.meshlets.size();
+                newFaces = std::move(currFaces);
+            } else if (group.first + group.num != storage.meshlets.size()) {
+                // Only the range at the back can grow in place
+                auto first = (IdxTy)storage.meshlets.size();
+                for (auto i = group.first; i < group.first + group.num; ++i) {
+                    auto m = storage.meshlets[i];
+                    storage.meshlets.emplace_back(m);
+                }
+                garbageNum += group.num;
+                group.first = first;
+            }
+            buildGroup(storage, newFaces, indices, positions);
+            group.num = storage.meshlets.size() - group.first;
+        }
+
+        if (garbageNum > storage.meshlets.size() / 2)
+            compact();
+    }
+
+  private:
+    void compact() {
+        Storage compacted;
+        for (auto &group : groups) {
+            auto first = (IdxTy)compacted.meshlets.size();
+            for (auto i = group.first; i < group.first + group.num; ++i) {
+                auto m = storage.meshlets[i];
+                auto vertFirst = (IdxTy)compacted.verts.size();
+                auto triFirst = (IdxTy)compacted.faces.size();
+                compacted.verts.insert(
+                    compacted.verts.end(),
+                    storage.verts.begin() + m.vertFirst,
+                    storage.verts.begin() + m.vertFirst + m.vertNum);
+                compacted.faces.insert(
+                    compacted.faces.end(), storage.faces.begin() + m.triFirst,
+                    storage.faces.begin() + m.triFirst + m.triNum);
+                compacted.tris.insert(
+                    compacted.tris.end(), storage.tris.begin() + m.triFirst,
+                    storage.tris.begin() + m.triFirst + m.triNum);
+                m.vertFirst = vertFirst;
+                m.triFirst = triFirst;
+                compacted.meshlets.emplace_back(m);
+            }
+            group.first = first;
+        }
+        storage = std::move(compacted);
+        garbageNum = 0;
+    }
+    // Greedily grow each meshlet by the adjacent face adding the fewest
+    // new vertices, falling back to the nearest face when none is left
+    static void buildGroup(Storage &out, Span<const IdxTy> groupFaces,
+                           StridedSpan<const glm::uint> indices,
+                           StridedSpan<const glm::vec3> positions) {
+        auto faceNum = (IdxTy)groupFaces.size();
+        if (faceNum == 0)
+            return;
+
+        // Vertices of the group as CSR of the local faces using them
+        std::vector<std::tuple<IdxTy, IdxTy>> vertFaces(faceNum * 3);
+        for (IdxTy f = 0; f < faceNum; ++f)
+            for (uint8_t c = 0; c < 3; ++c)
+                vertFaces[f * 3 + c] = {indices[groupFaces[f] * 3 + c], f};
+        std::sort(vertFaces.begin(), vertFaces.end());
+        std::vector<IdxTy> uniqVerts;
+        std::vector<IdxTy> uniqOffs;
+        std::vector<IdxTy> adjFaces(faceNum * 3);
+        std::vector<std::array<IdxTy, 3>> faceUniqs(faceNum);
+        std::vector<uint8_t> faceCornerCnts(faceNum, 0);
+        for (IdxTy i = 0; i < vertFaces.size(); ++i) {
+            auto [vIdx, f] = vertFaces[i];
+            if (uniqVerts.empty() || uniqVerts.back() != vIdx) {
+                uniqVerts.emplace_back(vIdx);
+                uniqOffs.emplace_back(i);
+            }
+            adjFaces[i] = f;
+            faceUniqs[f][faceCornerCnts[f]++] = uniqVerts.size() - 1;
+        }
+        uniqOffs.emplace_back(vertFaces.size());
+        // Corners were visited by vertex, restore the winding
+        for (IdxTy f = 0; f < faceNum; ++f) {
+            auto &us = faceUniqs[f];
+            std::array<IdxTy, 3> wound;
+            for (uint8_t c = 0; c < 3; ++c)
+                for (uint8_t k = 0; k < 3; ++k)
+                    if (uniqVerts[us[k]] == indices[groupFaces[f] * 3 + c]) {
+                        wound[c] = us[k];
+                        break;
+                    }
+            us = wound;
+        }
+
+        std::vector<glm::vec3> ctrs(faceNum);
+        for (IdxTy f = 0; f < faceNum; ++f)
+            ctrs[f] = (positions[uniqVerts[faceUniqs[f][0]]] +
+                       positions[uniqVerts[faceUniqs[f][1]]] +
+                       positions[uniqVerts[faceUniqs[f][2]]]) /
+                      3.f;
+
+        std::vector<bool> used(faceNum, false);
+        // meshlet the unique vertex was last added to, and its local index
+        std::vector<IdxTy> stamps(uniqVerts.size(),
+                                  std::numeric_limits<IdxTy>::max());
+        std::vector<uint8_t> locals(uniqVerts.size());
+        std::vector<IdxTy> cands;
+        IdxTy usedNum = 0, seed = 0;
+        while (usedNum != faceNum) {
+            auto mIdx = (IdxTy)out.meshlets.size();
+            auto &m = out.meshlets.emplace_back();
+            m.vertFirst = out.verts.size();
+            m.triFirst = out.faces.size();
+            m.vertNum = m.triNum = 0;
+            glm::vec3 ctrSum{0.f};
+            cands.clear();
+
+            auto newVertNum = [&](IdxTy f) {
+                uint8_t num = 0;
+                for (auto u : faceUniqs[f])
+                    num += stamps[u] != mIdx ? 1 : 0;
+                return num;
+            };
+            auto add = [&](IdxTy f) {
+                std::array<uint8_t, 3> tri;
+                for (uint8_t c = 0; c < 3; ++c) {
+                    auto u = faceUniqs[f][c];
+                    if (stamps[u] != mIdx) {
+                        stamps[u] = mIdx;
+                        locals[u] = m.vertNum++;
+                        out.verts.emplace_back(uniqVerts[u]);
+                    }
+                    tri[c] = locals[u];
+                    for (auto i = uniqOffs[u]; i < uniqOffs[u + 1]; ++i)
+                        if (!used[adjFaces[i]])
+                            cands.emplace_back(adjFaces[i]);
+                }
+                out.faces.emplace_back(groupFaces[f]);
+                out.tris.emplace_back(tri);
+                ++m.triNum;
+                used[f] = true;
+                ++usedNum;
+                ctrSum += ctrs[f];
+            };
+
+            while (used[seed])
+                ++seed;
+            add(seed);
+            while (m.triNum < MaxTriNum && usedNum != faceNum) {
+                IdxTy best = faceNum;
+                uint8_t bestNew = 4;
+                size_t kept = 0;
+                for (auto f : cands) {
+                    if (used[f])
+                        continue;
+                    cands[kept++] = f;
+                    if (auto num = newVertNum(f); num < bestNew) {
+                        best = f;
+                        bestNew = num;
+                    }
+                }
+                cands.resize(kept);
+
+                if (best == faceNum) {
+                    // Not adjacent to any face left, jump to the nearest
+                    auto ctr = ctrSum / (float)m.triNum;
+                    auto minDist = std::numeric_limits<float>::max();
+                    for (auto f = seed; f < faceNum; ++f)
+                        if (!used[f])
+                            if (auto dist = glm::dot(ctrs[f] - ctr,
+                                                     ctrs[f] - ctr);
+                                dist < minDist) {
+                                best = f;
+                                minDist = dist;
+                            }
+                    bestNew = newVertNum(best);
+                }
+                if (m.vertNum + bestNew > MaxVertNum)
+                    break;
+                add(best);
+            }
+
+            genBounds(m, out, positions);
+        }
+    }
+    // Bounds of the triangles only, vertices of faces removed by
+    // Rebuild() are left in verts unreferenced
+    static void genBounds(Meshlet &m, const Storage &storage,
+                          StridedSpan<const glm::vec3> positions) {
+        auto getPos = [&](IdxTy t, uint8_t c) -> const glm::vec3 & {
+            return positions[storage.verts[m.vertFirst + storage.tris[t][c]]];
+        };
+        m.aabb.min = glm::vec3{std::numeric_limits<float>::max()};
+        m.aabb.max = glm::vec3{std::numeric_limits<float>::lowest()};
+        for (auto t = m.triFirst; t < m.triFirst + m.triNum; ++t)
+            for (uint8_t c = 0; c < 3; ++c) {
+                m.aabb.min = glm::min(m.aabb.min, getPos(t, c));
+                m.aabb.max = glm::max(m.aabb.max, getPos(t, c));
+            }
+        m.ctr = .5f * (m.aabb.min + m.aabb.max);
+        m.radius = 0.f;
+        for (auto t = m.triFirst; t < m.triFirst + m.triNum; ++t)
+            for (uint8_t c = 0; c < 3; ++c)
+                m.radius =
+                    std::max(m.radius, glm::distance(m.ctr, getPos(t, c)));
+
+        // Degenerate faces have no orientation, but may still cover
+        // pixels on screen, so no cone can bound them
+        std::array<glm::vec3, MaxTriNum> norms;
+        glm::vec3 axis{0.f};
+        m.coneAxis = glm::vec3{0.f};
+        m.coneCos = -1.f;
+        for (auto t = m.triFirst; t < m.triFirst + m.triNum; ++t) {
+            auto &p0 = getPos(t, 0);
+            auto norm = glm::cross(getPos(t, 1) - p0, getPos(t, 2) - p0);
+            auto len = glm::length(norm);
+            if (len <= std::numeric_limits<float>::min())
+                return;
+            norms[t - m.triFirst] = norm / len;
+            axis += norms[t - m.triFirst];
+        }
+        auto len = glm::length(axis);
+        if (len <= std::numeric_limits<float>::min())
+            return;
+        m.coneAxis = axis / len;
+        m.coneCos = 1.f;
+        for (uint16_t i = 0; i < m.triNum; ++i)
+            m.coneCos = std::min(m.coneCos, glm::dot(norms[i], m.coneAxis));
+    }
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_MESHLET_H
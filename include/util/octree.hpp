@@ -4,13 +4,23 @@
 #include <iostream>
 #include <string>
 
+#include <algorithm>
+#include <cstring>
+
 #include <array>
 #include <queue>
 #include <stack>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+#include <util/hash.hpp>
+#include <util/mapped_file.hpp>
+#include <util/parallel.hpp>
+#include <util/span.hpp>
+
 namespace kouek {
 
 template <typename IdxTy, uint32_t Cap, uint32_t Height> class Octree {
@@ -46,22 +56,88 @@ template <typename IdxTy, uint32_t Cap, uint32_t Height> class Octree {
         }
     };
 
+    // Pointer-free form built by Linearize(). Nodes are stored in
+    // depth-first order, with the 8 children of an inner node
+    // contiguous, so a node's index also serves as its id.
+    struct LinearNode {
+        bool isLeaf;
+        // inner: children at [first, first + 8) of nodes,
+        //        their bounds at childBounds[dat]
+        // leaf:  data indices at [first, first + dat) of leafIndices
+        IdxTy first;
+        IdxTy dat;
+        glm::vec3 mid;
+        AABB looseAABB;
+    };
+    // Loose AABBs of 8 siblings as SoA, for 8-wide tests
+    struct ChildBounds {
+        alignas(32) std::array<std::array<float, 8>, 3> min;
+        alignas(32) std::array<std::array<float, 8>, 3> max;
+        // children holding any data
+        uint8_t nonEmptyMsk;
+    };
+
+    // NEAR_TO_FAR_CHILD_ORDERS[octant] lists child indices sorted by
+    // the number of split planes separating them from the viewer,
+    // where octant is the child index the viewer would fall into
+    static constexpr std::array<std::array<uint8_t, 8>, 8>
+        NEAR_TO_FAR_CHILD_ORDERS = [] {
+            std::array<std::array<uint8_t, 8>, 8> orders{};
+            for (uint8_t octant = 0; octant < 8; ++octant) {
+                uint8_t i = 0;
+                for (uint8_t sepNum = 0; sepNum <= 3; ++sepNum)
+                    for (uint8_t chIdx = 0; chIdx < 8; ++chIdx) {
+                        auto sep = chIdx ^ octant;
+                        if (((sep & 0x1) + ((sep >> 1) & 0x1) +
+                             ((sep >> 2) & 0x1)) == sepNum)
+                            orders[octant][i++] = chIdx;
+                    }
+            }
+            return orders;
+        }();
+
   private:
     Node *root;
 
+    std::vector<LinearNode> nodes;
+    std::vector<ChildBounds> childBounds;
+    std::vector<IdxTy> leafIndices;
+    // Views of the vectors above, or of a cache file loaded by Load()
+    std::shared_ptr<MappedFile> mapped;
+    Span<const LinearNode> nodeView;
+    Span<const ChildBounds> childBoundsView;
+    Span<const IdxTy> leafIndicesView;
+    // For Update(), generated on demand
+    std::vector<IdxTy> parents;
+    std::vector<IdxTy> datLeaves;
+    std::vector<bool> dirtyNodes;
+    // leafIndices no longer referenced by any leaf
+    size_t garbageNum = 0;
+
+    static constexpr uint32_t CACHE_MAGIC = 0x43544f4b; // "KOTC"
+    static constexpr uint32_t CACHE_VERSION = 1;
+    struct CacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t cap;
+        uint32_t height;
+        uint32_t idxSz;
+        uint32_t nodeSz;
+        uint32_t childBoundsSz;
+        uint32_t reserved;
+        uint64_t key;
+        uint64_t nodeNum;
+        uint64_t childBoundsNum;
+        uint64_t leafIndicesNum;
+        uint64_t nodeOffs;
+        uint64_t childBoundsOffs;
+        uint64_t leafIndicesOffs;
+        // hash of everything after the header
+        uint64_t payloadHash;
+    };
+
   public:
-    ~Octree() {
-        std::stack<Node *> stk;
-        stk.emplace(root);
-        while (!stk.empty()) {
-            auto node = stk.top();
-            stk.pop();
-            if (!node->isLeaf)
-                for (auto child : node->children)
-                    stk.emplace(child);
-            delete node;
-        }
-    }
+    ~Octree() { deleteTree(); }
     Octree() : root(new Node(true)) {
 #ifdef OTREE_NODE_WITH_NAME
         root->name = "0";
@@ -69,6 +145,34 @@ template <typename IdxTy, uint32_t Cap, uint32_t Height> class Octree {
     }
 
     auto GetRoot() { return root; }
+    static constexpr uint32_t CAP = Cap;
+    static constexpr uint32_t HEIGHT = Height;
+
+    const auto &GetNodes() const { return nodeView; }
+    const auto &GetChildBounds() const { return childBoundsView; }
+    const auto &GetLeafIndices() const { return leafIndicesView; }
+    IdxTy GetNodeNum() const { return nodeView.size(); }
+    // Identifies which part of space each node index refers to, which
+    // refitting and data moving between leaves keep
+    uint64_t GetNodeHash() const {
+        uint64_t h = 0;
+        for (auto &node : nodeView) {
+            std::array<float, 4> dat{node.isLeaf ? 1.f : 0.f, node.mid.x,
+                                     node.mid.y, node.mid.z};
+            h = Hash64(dat.data(), sizeof(dat), h);
+            if (!node.isLeaf)
+                h = Hash64(&node.first, sizeof(IdxTy), h);
+        }
+        return h;
+    }
+    static inline uint8_t GetOctant(const LinearNode &node,
+                                    const glm::vec3 &eye) {
+        uint8_t octant = 0;
+        for (uint8_t xyz = 0; xyz < 3; ++xyz)
+            if (eye[xyz] >= node.mid[xyz])
+                octant |= 1 << xyz;
+        return octant;
+    }
     IdxTy GetLeafDatNum(Node *node) {
         IdxTy num = 0;
         std::stack<Node *> stk;
@@ -138,18 +242,69 @@ template <typename IdxTy, uint32_t Cap, uint32_t Height> class Octree {
             }
         }
     }
-    void Reset(const AABB &rootAABB) {
-        std::stack<Node *> stk;
-        stk.emplace(root);
+    // Flatten the tree built by Add() into nodes, childBounds and
+    // leafIndices, then free it. Add() needs a Reset() afterwards.
+    void Linearize() {
+        nodes.clear();
+        childBounds.clear();
+        leafIndices.clear();
+
+        std::stack<std::tuple<Node *, IdxTy>> stk;
+        nodes.emplace_back();
+        stk.emplace(root, 0);
         while (!stk.empty()) {
-            auto node = stk.top();
+            auto [node, lnIdx] = stk.top();
             stk.pop();
-            if (!node->isLeaf)
-                for (auto child : node->children)
-                    stk.emplace(child);
-            delete node;
+
+            LinearNode ln;
+            ln.isLeaf = node->isLeaf;
+            ln.mid = .5f * (node->aabb.min + node->aabb.max);
+            ln.looseAABB = node->looseAABB;
+            if (node->isLeaf) {
+                ln.first = leafIndices.size();
+                ln.dat = node->leafDats.size();
+                for (const auto &leafDat : node->leafDats)
+                    leafIndices.emplace_back(leafDat.idx);
+            } else {
+                ln.first = nodes.size();
+                ln.dat = childBounds.size();
+                nodes.resize(nodes.size() + 8);
+
+                auto &bounds = childBounds.emplace_back();
+                bounds.nonEmptyMsk = 0;
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx) {
+                    auto child = node->children[chIdx];
+                    for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+                        bounds.min[xyz][chIdx] = child->looseAABB.min[xyz];
+                        bounds.max[xyz][chIdx] = child->looseAABB.max[xyz];
+                    }
+                    if (!child->isLeaf || !child->leafDats.empty())
+                        bounds.nonEmptyMsk |= 1 << chIdx;
+                }
+                // Reversed, so that subtrees are laid out in child order
+                for (uint8_t chIdx = 8; chIdx > 0; --chIdx)
+                    stk.emplace(node->children[chIdx - 1],
+                                ln.first + chIdx - 1);
+            }
+            nodes[lnIdx] = ln;
         }
 
+        deleteTree();
+        root = new Node(true);
+#ifdef OTREE_NODE_WITH_NAME
+        root->name = "0";
+#endif // !OTREE_NODE_WITH_NAME
+        resetViews();
+        resetUpdateState();
+    }
+    void Reset(const AABB &rootAABB) {
+        deleteTree();
+        nodes.clear();
+        childBounds.clear();
+        leafIndices.clear();
+        resetViews();
+        resetUpdateState();
+
         root = new Node(true);
 #ifdef OTREE_NODE_WITH_NAME
         root->name = "0";
@@ -157,8 +312,522 @@ template <typename IdxTy, uint32_t Cap, uint32_t Height> class Octree {
         root->aabb = rootAABB;
         root->looseAABB = rootAABB;
     }
+    // Take the linear form built before, e.g. of another octree with its
+    // data renumbered
+    void Assign(Span<const LinearNode> nodes,
+                Span<const ChildBounds> childBounds,
+                Span<const IdxTy> leafIndices) {
+        deleteTree();
+        root = new Node(true);
+#ifdef OTREE_NODE_WITH_NAME
+        root->name = "0";
+#endif // !OTREE_NODE_WITH_NAME
+        this->nodes.assign(nodes.begin(), nodes.end());
+        this->childBounds.assign(childBounds.begin(), childBounds.end());
+        this->leafIndices.assign(leafIndices.begin(), leafIndices.end());
+        resetViews();
+        resetUpdateState();
+    }
+    // Build the linear form directly, in place of Add() + Linearize().
+    // Faces are sorted by the Morton codes of their AABB centers within
+    // the root AABB given to Reset(), so that every node covers a
+    // contiguous range of them. Nodes are then emitted top-down by
+    // splitting the ranges and their loose AABBs reduced bottom-up.
+    void Build(const std::vector<AABB> &aabbs,
+               const std::vector<IdxTy> &indices) {
+        static_assert(Height <= 21, "Morton codes are limited to 64 bits");
+        using MortonTy = std::conditional_t<(Height <= 10), uint32_t, uint64_t>;
+
+        auto rootAABB = root->aabb;
+        deleteTree();
+        root = new Node(true);
+        root->aabb = root->looseAABB = rootAABB;
+
+        size_t num = indices.size();
+        std::vector<MortonTy> codes(num);
+        std::vector<IdxTy> poses(num);
+        ParallelFor(num, [&](size_t beg, size_t end, uint32_t) {
+            glm::vec3 scale;
+            for (uint8_t xyz = 0; xyz < 3; ++xyz)
+                scale[xyz] = rootAABB.max[xyz] > rootAABB.min[xyz]
+                                 ? (float)(1 << Height) /
+                                       (rootAABB.max[xyz] - rootAABB.min[xyz])
+                                 : 0.f;
+            for (auto i = beg; i < end; ++i) {
+                auto c = (.5f * (aabbs[i].min + aabbs[i].max) - rootAABB.min) *
+                         scale;
+                MortonTy code = 0;
+                for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+                    auto q = c[xyz] >= 0.f ? (MortonTy)c[xyz] : (MortonTy)0;
+                    if (q >= ((MortonTy)1 << Height))
+                        q = ((MortonTy)1 << Height) - 1;
+                    for (uint32_t b = 0; b < Height; ++b)
+                        code |= ((q >> b) & 0x1) << (3 * b + xyz);
+                }
+                codes[i] = code;
+                poses[i] = i;
+            }
+        });
+        radixSort(codes, poses);
+
+        // Top-down Emitting
+        nodes.clear();
+        childBounds.clear();
+        std::vector<decltype(Height)> depths;
+        std::stack<std::tuple<IdxTy, IdxTy, decltype(Height), AABB, IdxTy>>
+            stk;
+        nodes.emplace_back();
+        depths.emplace_back(0);
+        stk.emplace(0, num, 0, rootAABB, 0);
+        while (!stk.empty()) {
+            auto [beg, end, h, aabb, lnIdx] = stk.top();
+            stk.pop();
+
+            auto &ln = nodes[lnIdx];
+            ln.mid = .5f * (aabb.min + aabb.max);
+            ln.looseAABB = aabb;
+            if (end - beg <= Cap || h >= Height) {
+                ln.isLeaf = true;
+                ln.first = beg;
+                ln.dat = end - beg;
+                continue;
+            }
+            ln.isLeaf = false;
+            ln.first = nodes.size();
+            ln.dat = childBounds.size();
+            childBounds.emplace_back();
+            auto mid = ln.mid;
+            nodes.resize(nodes.size() + 8);
+            depths.resize(nodes.size(), h + 1);
+
+            auto shft = 3 * (Height - 1 - h);
+            std::array<IdxTy, 9> chBegs;
+            chBegs[0] = beg;
+            chBegs[8] = end;
+            for (uint8_t chIdx = 1; chIdx < 8; ++chIdx)
+                chBegs[chIdx] = std::partition_point(
+                                    codes.begin() + chBegs[chIdx - 1],
+                                    codes.begin() + end,
+                                    [&](MortonTy code) {
+                                        return ((code >> shft) & 0x7) < chIdx;
+                                    }) -
+                                codes.begin();
+            auto first = nodes[lnIdx].first;
+            for (uint8_t chIdx = 8; chIdx > 0; --chIdx)
+                stk.emplace(chBegs[chIdx - 1], chBegs[chIdx], h + 1,
+                            genOctCmp(aabb, mid, chIdx - 1), first + chIdx - 1);
+        }
+
+        // Bottom-up Loose AABB Reduction, level by level
+        std::vector<std::vector<IdxTy>> lvls;
+        for (IdxTy lnIdx = 0; lnIdx < nodes.size(); ++lnIdx) {
+            if (lvls.size() <= depths[lnIdx])
+                lvls.resize(depths[lnIdx] + 1);
+            lvls[depths[lnIdx]].emplace_back(lnIdx);
+        }
+        for (auto lvl = lvls.rbegin(); lvl != lvls.rend(); ++lvl)
+            ParallelFor(lvl->size(), [&](size_t beg, size_t end, uint32_t) {
+                for (auto i = beg; i < end; ++i) {
+                    auto &ln = nodes[(*lvl)[i]];
+                    if (ln.isLeaf) {
+                        if (ln.dat == 0)
+                            continue;
+                        ln.looseAABB = aabbs[poses[ln.first]];
+                        for (auto j = ln.first + 1; j < ln.first + ln.dat; ++j)
+                            unionAABB(ln.looseAABB, aabbs[poses[j]]);
+                        continue;
+                    }
+
+                    auto &bounds = childBounds[ln.dat];
+                    bounds.nonEmptyMsk = 0;
+                    for (uint8_t chIdx = 0; chIdx < 8; ++chIdx) {
+                        auto &ch = nodes[ln.first + chIdx];
+                        for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+                            bounds.min[xyz][chIdx] = ch.looseAABB.min[xyz];
+                            bounds.max[xyz][chIdx] = ch.looseAABB.max[xyz];
+                        }
+                        if (ch.isLeaf && ch.dat == 0)
+                            continue;
+                        if (bounds.nonEmptyMsk == 0)
+                            ln.looseAABB = ch.looseAABB;
+                        else
+                            unionAABB(ln.looseAABB, ch.looseAABB);
+                        bounds.nonEmptyMsk |= 1 << chIdx;
+                    }
+                }
+            });
+
+        leafIndices.resize(num);
+        ParallelFor(num, [&](size_t beg, size_t end, uint32_t) {
+            for (auto i = beg; i < end; ++i)
+                leafIndices[i] = indices[poses[i]];
+        });
+        // Data of a leaf by index, so that data laid out by leaf beforehand
+        // takes the same contiguous range in leafIndices
+        ParallelFor(nodes.size(), [&](size_t beg, size_t end, uint32_t) {
+            for (auto i = beg; i < end; ++i)
+                if (nodes[i].isLeaf)
+                    std::sort(leafIndices.begin() + nodes[i].first,
+                              leafIndices.begin() + nodes[i].first +
+                                  nodes[i].dat);
+        });
+        resetViews();
+        resetUpdateState();
+    }
+    // Refit after the AABBs of data in datIndices changed, where
+    // getAABB(idx) returns the new AABB of data idx. Data whose AABB
+    // center left its leaf is moved to the leaf now containing it, which
+    // may grow past Cap until the next Build(). Loose AABBs are then refit
+    // along the paths from the touched leaves to the root only.
+    // Returns the indices of the touched leaves.
+    template <typename F>
+    std::vector<IdxTy> Update(const std::vector<IdxTy> &datIndices,
+                              const F &getAABB) {
+        return update(datIndices, getAABB, false);
+    }
+    // Add data in datIndices, not in the octree yet, to the leaves
+    // containing their AABB centers, then refit as Update() does. The
+    // octree must have been built, and data outside the root AABB given
+    // to Reset() only lands in the boundary leaves, so Build() again once
+    // the data has grown much. Returns the indices of the touched leaves.
+    template <typename F>
+    std::vector<IdxTy> Insert(const std::vector<IdxTy> &datIndices,
+                              const F &getAABB) {
+        return update(datIndices, getAABB, true);
+    }
+    // The linear form tagged with key, which should identify the source
+    // data (e.g. a hash of the mesh), as written by Save(). Without leaf
+    // indices, only the nodes and their bounds are usable once loaded.
+    std::vector<uint8_t> Serialize(uint64_t key,
+                                   bool withLeafIndices = true) const {
+        auto align = [](uint64_t offs) {
+            return (offs + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT *
+                   CACHE_ALIGNMENT;
+        };
+        CacheHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = CACHE_MAGIC;
+        header.version = CACHE_VERSION;
+        header.cap = Cap;
+        header.height = Height;
+        header.idxSz = sizeof(IdxTy);
+        header.nodeSz = sizeof(LinearNode);
+        header.childBoundsSz = sizeof(ChildBounds);
+        header.key = key;
+        header.nodeNum = nodeView.size();
+        header.childBoundsNum = childBoundsView.size();
+        header.leafIndicesNum =
+            withLeafIndices ? leafIndicesView.size() : 0;
+        header.nodeOffs = align(sizeof(CacheHeader));
+        header.childBoundsOffs =
+            align(header.nodeOffs + sizeof(LinearNode) * header.nodeNum);
+        header.leafIndicesOffs = align(header.childBoundsOffs +
+                                       sizeof(ChildBounds) *
+                                           header.childBoundsNum);
+
+        std::vector<uint8_t> buf(header.leafIndicesOffs +
+                                     sizeof(IdxTy) * header.leafIndicesNum,
+                                 0);
+        std::memcpy(buf.data() + header.nodeOffs, nodeView.data(),
+                    sizeof(LinearNode) * header.nodeNum);
+        std::memcpy(buf.data() + header.childBoundsOffs,
+                    childBoundsView.data(),
+                    sizeof(ChildBounds) * header.childBoundsNum);
+        std::memcpy(buf.data() + header.leafIndicesOffs,
+                    leafIndicesView.data(),
+                    sizeof(IdxTy) * header.leafIndicesNum);
+        header.payloadHash = Hash64(buf.data() + sizeof(CacheHeader),
+                                    buf.size() - sizeof(CacheHeader));
+        std::memcpy(buf.data(), &header, sizeof(header));
+        return buf;
+    }
+    // Write Serialize() to path. Returns false on I/O failure.
+    bool Save(const std::string &path, uint64_t key) const {
+        auto buf = Serialize(key);
+        return WriteFileAside(path, [&](std::ostream &os) {
+            os.write((const char *)buf.data(), buf.size());
+        });
+    }
+    // Map the cache file at path and use it in place, without copying.
+    // Returns false if it is missing, corrupt or does not match key and
+    // the template parameters, leaving the octree unchanged.
+    bool Load(const std::string &path, uint64_t key) {
+        auto file = MappedFile::Open(path);
+        return file && Load(file, 0, file->size(), key);
+    }
+    // Use Serialize() stored at [offs, offs + sz) of a mapped file in
+    // place, offs being aligned to 64 bytes
+    bool Load(std::shared_ptr<MappedFile> file, uint64_t offs, uint64_t sz,
+              uint64_t key) {
+        if (offs % CACHE_ALIGNMENT != 0 || offs > file->size() ||
+            sz > file->size() - offs || sz < sizeof(CacheHeader))
+            return false;
+        auto dat = file->data() + offs;
+
+        CacheHeader header;
+        std::memcpy(&header, dat, sizeof(header));
+        if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+            header.cap != Cap || header.height != Height ||
+            header.idxSz != sizeof(IdxTy) ||
+            header.nodeSz != sizeof(LinearNode) ||
+            header.childBoundsSz != sizeof(ChildBounds) || header.key != key)
+            return false;
+        auto inFile = [&](uint64_t offs, uint64_t elemSz, uint64_t num) {
+            return offs % CACHE_ALIGNMENT == 0 && offs <= sz &&
+                   num <= (sz - offs) / elemSz;
+        };
+        if (!inFile(header.nodeOffs, sizeof(LinearNode), header.nodeNum) ||
+            !inFile(header.childBoundsOffs, sizeof(ChildBounds),
+                    header.childBoundsNum) ||
+            !inFile(header.leafIndicesOffs, sizeof(IdxTy),
+                    header.leafIndicesNum))
+            return false;
+        if (Hash64(dat + sizeof(CacheHeader), sz - sizeof(CacheHeader)) !=
+            header.payloadHash)
+            return false;
+
+        deleteTree();
+        root = new Node(true);
+        nodes.clear();
+        nodes.shrink_to_fit();
+        childBounds.clear();
+        childBounds.shrink_to_fit();
+        leafIndices.clear();
+        leafIndices.shrink_to_fit();
+        nodeView = Span<const LinearNode>(
+            (const LinearNode *)(dat + header.nodeOffs), header.nodeNum);
+        childBoundsView = Span<const ChildBounds>(
+            (const ChildBounds *)(dat + header.childBoundsOffs),
+            header.childBoundsNum);
+        leafIndicesView = Span<const IdxTy>(
+            (const IdxTy *)(dat + header.leafIndicesOffs),
+            header.leafIndicesNum);
+        mapped = file;
+        resetUpdateState();
+        return true;
+    }
 
   private:
+    static constexpr uint64_t CACHE_ALIGNMENT = 64;
+
+    void resetViews() {
+        mapped.reset();
+        nodeView = nodes;
+        childBoundsView = childBounds;
+        leafIndicesView = leafIndices;
+    }
+    void resetUpdateState() {
+        parents.clear();
+        datLeaves.clear();
+        dirtyNodes.clear();
+        garbageNum = 0;
+    }
+    void genUpdateState() {
+        parents.assign(nodes.size(), 0);
+        dirtyNodes.assign(nodes.size(), false);
+        datLeaves.clear();
+        for (IdxTy lnIdx = 0; lnIdx < nodes.size(); ++lnIdx) {
+            const auto &ln = nodes[lnIdx];
+            if (!ln.isLeaf) {
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                    parents[ln.first + chIdx] = lnIdx;
+                continue;
+            }
+            for (auto i = ln.first; i < ln.first + ln.dat; ++i) {
+                if (datLeaves.size() <= leafIndices[i])
+                    datLeaves.resize(leafIndices[i] + 1, 0);
+                datLeaves[leafIndices[i]] = lnIdx;
+            }
+        }
+    }
+    template <typename F>
+    std::vector<IdxTy> update(const std::vector<IdxTy> &datIndices,
+                              const F &getAABB, bool isNew) {
+        std::vector<IdxTy> touchedLeaves;
+        if (nodeView.empty() || datIndices.empty())
+            return touchedLeaves;
+        if (mapped) {
+            nodes.assign(nodeView.begin(), nodeView.end());
+            childBounds.assign(childBoundsView.begin(), childBoundsView.end());
+            leafIndices.assign(leafIndicesView.begin(), leafIndicesView.end());
+        }
+        if (parents.size() != nodes.size())
+            genUpdateState();
+
+        // Children are always stored after their parent, so popping the
+        // largest index first refits bottom-up
+        std::priority_queue<IdxTy> dirties;
+        auto markDirty = [&](IdxTy lnIdx) {
+            if (dirtyNodes[lnIdx])
+                return;
+            dirtyNodes[lnIdx] = true;
+            dirties.emplace(lnIdx);
+        };
+        auto markLeafDirty = [&](IdxTy lnIdx) {
+            if (!dirtyNodes[lnIdx])
+                touchedLeaves.emplace_back(lnIdx);
+            markDirty(lnIdx);
+        };
+        for (auto idx : datIndices) {
+            auto aabb = getAABB(idx);
+            auto newLeaf = locateLeaf(.5f * (aabb.min + aabb.max));
+            if (isNew) {
+                if (datLeaves.size() <= idx)
+                    datLeaves.resize(idx + 1, 0);
+            } else {
+                auto oldLeaf = datLeaves[idx];
+                markLeafDirty(oldLeaf);
+                if (newLeaf == oldLeaf)
+                    continue;
+
+                auto &oldLn = nodes[oldLeaf];
+                for (auto i = oldLn.first; i < oldLn.first + oldLn.dat; ++i)
+                    if (leafIndices[i] == idx) {
+                        leafIndices[i] =
+                            leafIndices[oldLn.first + oldLn.dat - 1];
+                        break;
+                    }
+                --oldLn.dat;
+                ++garbageNum;
+            }
+
+            // Only the range at the back can grow in place
+            auto &newLn = nodes[newLeaf];
+            if (newLn.first + newLn.dat != leafIndices.size()) {
+                auto first = leafIndices.size();
+                for (auto i = newLn.first; i < newLn.first + newLn.dat; ++i) {
+                    auto moved = leafIndices[i];
+                    leafIndices.emplace_back(moved);
+                }
+                newLn.first = first;
+                garbageNum += newLn.dat;
+            }
+            leafIndices.emplace_back(idx);
+            ++newLn.dat;
+            datLeaves[idx] = newLeaf;
+            markLeafDirty(newLeaf);
+        }
+
+        while (!dirties.empty()) {
+            auto lnIdx = dirties.top();
+            dirties.pop();
+            dirtyNodes[lnIdx] = false;
+
+            auto &ln = nodes[lnIdx];
+            auto prevAABB = ln.looseAABB;
+            auto prevEmpty = ln.isLeaf && ln.dat == 0;
+            if (ln.isLeaf) {
+                // Empty leaves keep their last AABB, as in Build()
+                if (ln.dat != 0) {
+                    ln.looseAABB = getAABB(leafIndices[ln.first]);
+                    for (auto i = ln.first + 1; i < ln.first + ln.dat; ++i)
+                        unionAABB(ln.looseAABB, getAABB(leafIndices[i]));
+                }
+            } else {
+                auto &bounds = childBounds[ln.dat];
+                bounds.nonEmptyMsk = 0;
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx) {
+                    auto &ch = nodes[ln.first + chIdx];
+                    for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+                        bounds.min[xyz][chIdx] = ch.looseAABB.min[xyz];
+                        bounds.max[xyz][chIdx] = ch.looseAABB.max[xyz];
+                    }
+                    if (ch.isLeaf && ch.dat == 0)
+                        continue;
+                    if (bounds.nonEmptyMsk == 0)
+                        ln.looseAABB = ch.looseAABB;
+                    else
+                        unionAABB(ln.looseAABB, ch.looseAABB);
+                    bounds.nonEmptyMsk |= 1 << chIdx;
+                }
+            }
+
+            // A leaf becoming (non-)empty changes its parent's mask
+            if (lnIdx == 0 || (ln.looseAABB.min == prevAABB.min &&
+                               ln.looseAABB.max == prevAABB.max &&
+                               (ln.isLeaf && ln.dat == 0) == prevEmpty))
+                continue;
+            markDirty(parents[lnIdx]);
+        }
+
+        if (garbageNum > leafIndices.size() / 2)
+            compactLeafIndices();
+        resetViews();
+        return touchedLeaves;
+    }
+    IdxTy locateLeaf(const glm::vec3 &pos) const {
+        IdxTy lnIdx = 0;
+        while (!nodes[lnIdx].isLeaf)
+            lnIdx = nodes[lnIdx].first + GetOctant(nodes[lnIdx], pos);
+        return lnIdx;
+    }
+    void compactLeafIndices() {
+        std::vector<IdxTy> compacted;
+        compacted.reserve(leafIndices.size() - garbageNum);
+        for (auto &ln : nodes) {
+            if (!ln.isLeaf)
+                continue;
+            auto first = compacted.size();
+            compacted.insert(compacted.end(), leafIndices.begin() + ln.first,
+                             leafIndices.begin() + ln.first + ln.dat);
+            ln.first = first;
+        }
+        leafIndices = std::move(compacted);
+        garbageNum = 0;
+    }
+    // Parallel LSD radix sort of keys, carrying vals along
+    template <typename KeyTy>
+    static void radixSort(std::vector<KeyTy> &keys, std::vector<IdxTy> &vals) {
+        static constexpr uint32_t RADIX_BITS = 8;
+        static constexpr uint32_t BUCKET_NUM = 1 << RADIX_BITS;
+        static constexpr uint32_t PASS_NUM =
+            (3 * Height + RADIX_BITS - 1) / RADIX_BITS;
+
+        size_t num = keys.size();
+        std::vector<KeyTy> tmpKeys(num);
+        std::vector<IdxTy> tmpVals(num);
+        std::vector<std::array<size_t, BUCKET_NUM>> cnts(GetThreadNum());
+        for (uint32_t pass = 0; pass < PASS_NUM; ++pass) {
+            auto shft = pass * RADIX_BITS;
+            ParallelFor(num, [&](size_t beg, size_t end, uint32_t chunkIdx) {
+                auto &cnt = cnts[chunkIdx];
+                cnt.fill(0);
+                for (auto i = beg; i < end; ++i)
+                    ++cnt[(keys[i] >> shft) & (BUCKET_NUM - 1)];
+            });
+            // Exclusive prefix sum over (bucket, chunk), keeping it stable
+            auto chunkNum = (uint32_t)std::min<size_t>(GetThreadNum(), num);
+            size_t sum = 0;
+            for (uint32_t b = 0; b < BUCKET_NUM; ++b)
+                for (uint32_t c = 0; c < chunkNum; ++c) {
+                    auto cnt = cnts[c][b];
+                    cnts[c][b] = sum;
+                    sum += cnt;
+                }
+            ParallelFor(num, [&](size_t beg, size_t end, uint32_t chunkIdx) {
+                auto &offs = cnts[chunkIdx];
+                for (auto i = beg; i < end; ++i) {
+                    auto dst = offs[(keys[i] >> shft) & (BUCKET_NUM - 1)]++;
+                    tmpKeys[dst] = keys[i];
+                    tmpVals[dst] = vals[i];
+                }
+            });
+            keys.swap(tmpKeys);
+            vals.swap(tmpVals);
+        }
+    }
+    void deleteTree() {
+        std::stack<Node *> stk;
+        stk.emplace(root);
+        while (!stk.empty()) {
+            auto node = stk.top();
+            stk.pop();
+            if (!node->isLeaf)
+                for (auto child : node->children)
+                    stk.emplace(child);
+            delete node;
+        }
+    }
     static inline AABB genOctCmp(const AABB &parAABB, const glm::vec3 &mid,
                                  uint8_t chIdx) {
         AABB aabb;
@@ -220,33 +889,37 @@ template <typename IdxTy, uint32_t Cap, uint32_t Height> class Octree {
 };
 
 template <typename IdxTy, uint32_t Cap, uint32_t Height>
-std::ostream &operator<<(std::ostream &os, Octree<IdxTy, Cap, Height> &otree) {
+std::ostream &operator<<(std::ostream &os,
+                         const Octree<IdxTy, Cap, Height> &otree) {
     decltype(Height) maxH = 0;
     IdxTy maxLeafDatNum = 0;
     IdxTy leafDatTotNum = 0;
     size_t leafNodeNum = 0;
-    std::stack<std::tuple<Octree<IdxTy, Cap, Height>::Node *, decltype(Height)>>
-        stk;
-    stk.emplace(otree.GetRoot(), 0);
+    const auto &nodes = otree.GetNodes();
+    std::stack<std::tuple<IdxTy, decltype(Height)>> stk;
+    if (!nodes.empty())
+        stk.emplace(0, 0);
     while (!stk.empty()) {
         auto [top, h] = stk.top();
         stk.pop();
-        if (top->isLeaf) {
-            if (maxLeafDatNum < top->leafDats.size())
-                maxLeafDatNum = top->leafDats.size();
+        const auto &node = nodes[top];
+        if (node.isLeaf) {
+            if (maxLeafDatNum < node.dat)
+                maxLeafDatNum = node.dat;
             if (maxH < h)
                 maxH = h;
-            leafDatTotNum += top->leafDats.size();
+            leafDatTotNum += node.dat;
             ++leafNodeNum;
         } else
-            for (auto child : top->children)
-                stk.emplace(child, h + 1);
+            for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                stk.emplace(node.first + chIdx, h + 1);
     }
     os << "Octree" << std::endl;
     os << ">> Max Leaf Data Num: " << maxLeafDatNum << std::endl;
     os << ">> Max Height: " << maxH << std::endl;
     os << ">> Leaf Data Total Num: " << leafDatTotNum << std::endl;
     os << ">> Leaf Node Num: " << leafNodeNum << std::endl;
+    os << ">> Node Num: " << nodes.size() << std::endl;
     return os;
 }
 
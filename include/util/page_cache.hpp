@@ -0,0 +1,159 @@
+#ifndef KOUEK_PAGE_CACHE_H
+#define KOUEK_PAGE_CACHE_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace kouek {
+
+// Pages read by key on demand, or ahead of time on a background thread,
+// kept within a budget of bytes by evicting the least recently used.
+// PageTy has GetByteNum(). Pages handed out stay valid while held, even
+// once evicted. All methods are thread-safe.
+template <typename KeyTy, typename PageTy> class PageCache {
+  public:
+    // Returns nullptr if the page can't be read
+    using ReadFunc = std::function<std::shared_ptr<const PageTy>(KeyTy)>;
+
+  private:
+    // Requests of the last frames are likely out of view already
+    static constexpr size_t MAX_PREFETCH_NUM = 256;
+
+    struct Entry {
+        std::shared_ptr<const PageTy> page;
+        size_t byteNum;
+        // last frame it was used in
+        uint64_t frame;
+        typename std::list<KeyTy>::iterator lruItr;
+    };
+
+    size_t budget;
+    ReadFunc read;
+
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::unordered_map<KeyTy, Entry> entries;
+    // keys of entries, the most recently used first
+    std::list<KeyTy> lru;
+    size_t byteNum = 0;
+    uint64_t frame = 0;
+    // being read by any thread, which others wait for instead
+    std::unordered_set<KeyTy> readings;
+    std::deque<KeyTy> prefetches;
+    bool stopped = false;
+    std::thread prefetcher;
+
+  public:
+    PageCache(size_t budget, ReadFunc read)
+        : budget(budget), read(std::move(read)) {
+        prefetcher = std::thread([this]() { runPrefetcher(); });
+    }
+    ~PageCache() {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            stopped = true;
+        }
+        cv.notify_all();
+        prefetcher.join();
+    }
+
+    size_t GetBudget() const { return budget; }
+    size_t GetByteNum() const {
+        std::lock_guard<std::mutex> lk(mtx);
+        return byteNum;
+    }
+
+    // Mark the start of a frame. Prefetches not yet served are dropped.
+    void NextFrame() {
+        std::lock_guard<std::mutex> lk(mtx);
+        ++frame;
+        prefetches.clear();
+    }
+    // The page of key, read now on a miss
+    std::shared_ptr<const PageTy> Get(KeyTy key) {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [&]() { return readings.count(key) == 0; });
+        if (auto itr = entries.find(key); itr != entries.end()) {
+            auto &entry = itr->second;
+            entry.frame = frame;
+            lru.splice(lru.begin(), lru, entry.lruItr);
+            return entry.page;
+        }
+
+        readings.emplace(key);
+        lk.unlock();
+        auto page = read(key);
+        lk.lock();
+        readings.erase(key);
+        if (page)
+            insert(key, page, false);
+        lk.unlock();
+        cv.notify_all();
+        return page;
+    }
+    // Read the page of key in the background if it is not cached, unless
+    // that evicts pages used in this or the last frame
+    void Prefetch(KeyTy key) {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (entries.count(key) != 0 || readings.count(key) != 0 ||
+                prefetches.size() >= MAX_PREFETCH_NUM)
+                return;
+            prefetches.emplace_back(key);
+        }
+        cv.notify_all();
+    }
+
+  private:
+    // With mtx held
+    void insert(KeyTy key, std::shared_ptr<const PageTy> page,
+                bool prefetched) {
+        auto pageByteNum = page->GetByteNum();
+        if (pageByteNum > budget || entries.count(key) != 0)
+            return;
+        while (byteNum + pageByteNum > budget) {
+            auto &victim = entries.at(lru.back());
+            if (prefetched && victim.frame + 1 >= frame)
+                return;
+            byteNum -= victim.byteNum;
+            entries.erase(lru.back());
+            lru.pop_back();
+        }
+        lru.emplace_front(key);
+        entries.emplace(key, Entry{page, pageByteNum, frame, lru.begin()});
+        byteNum += pageByteNum;
+    }
+    void runPrefetcher() {
+        std::unique_lock<std::mutex> lk(mtx);
+        while (true) {
+            cv.wait(lk, [&]() { return stopped || !prefetches.empty(); });
+            if (stopped)
+                return;
+            auto key = prefetches.front();
+            prefetches.pop_front();
+            if (entries.count(key) != 0 || readings.count(key) != 0)
+                continue;
+
+            readings.emplace(key);
+            lk.unlock();
+            auto page = read(key);
+            lk.lock();
+            readings.erase(key);
+            if (page)
+                insert(key, page, true);
+            cv.notify_all();
+        }
+    }
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_PAGE_CACHE_H
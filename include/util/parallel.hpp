@@ -0,0 +1,41 @@
+#ifndef KOUEK_PARALLEL_H
+#define KOUEK_PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace kouek {
+
+inline uint32_t GetThreadNum() {
+    static const uint32_t num =
+        std::max(std::thread::hardware_concurrency(), 1u);
+    return num;
+}
+
+// Split [0, num) into at most GetThreadNum() contiguous chunks and run
+// f(begin, end, chunkIdx) on each chunk in its own thread.
+// Chunk chunkIdx always covers [num * chunkIdx / chunkNum, ...).
+template <typename F> void ParallelFor(size_t num, const F &f) {
+    if (num == 0)
+        return;
+    auto chunkNum = (uint32_t)std::min<size_t>(GetThreadNum(), num);
+    if (chunkNum == 1) {
+        f((size_t)0, num, (uint32_t)0);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(chunkNum - 1);
+    for (uint32_t c = 1; c < chunkNum; ++c)
+        threads.emplace_back([&, c]() {
+            f(num * c / chunkNum, num * (c + 1) / chunkNum, c);
+        });
+    f((size_t)0, num / chunkNum, (uint32_t)0);
+    for (auto &thread : threads)
+        thread.join();
+}
+
+} // namespace kouek
+
+#endif // !KOUEK_PARALLEL_H
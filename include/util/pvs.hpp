@@ -0,0 +1,172 @@
+#ifndef KOUEK_PVS_H
+#define KOUEK_PVS_H
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <algorithm>
+#include <cstring>
+
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <util/hash.hpp>
+
+namespace kouek {
+
+// Potentially Visible Sets of octree nodes, one per cell of a uniform grid
+// over the region the camera moves in, in the local space of the octree.
+// Precomputed offline by sampling views in each cell.
+class PVS {
+  private:
+    static constexpr uint32_t FILE_MAGIC = 0x5356504b; // "KPVS"
+    static constexpr uint32_t FILE_VERSION = 1;
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t nodeNum;
+        uint32_t setNum;
+        glm::uvec3 cellNum;
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    glm::vec3 min, max;
+    glm::uvec3 cellNum;
+    // of the octree whose nodes are indexed
+    uint64_t key = 0;
+    uint32_t nodeNum = 0;
+    uint32_t wordNum = 0;
+    // wordNum words of node bits by cell
+    std::vector<uint64_t> bits;
+
+  public:
+    PVS(const glm::vec3 &min, const glm::vec3 &max, const glm::uvec3 &cellNum)
+        : min{min}, max{max}, cellNum{glm::max(cellNum, glm::uvec3{1})} {}
+
+    size_t GetCellNum() const {
+        return (size_t)cellNum.x * cellNum.y * cellNum.z;
+    }
+    glm::vec3 GetCellMin(size_t cellIdx) const {
+        glm::uvec3 xyz{cellIdx % cellNum.x, cellIdx / cellNum.x % cellNum.y,
+                       cellIdx / cellNum.x / cellNum.y};
+        return min + (max - min) * glm::vec3{xyz} / glm::vec3{cellNum};
+    }
+    glm::vec3 GetCellMax(size_t cellIdx) const {
+        return GetCellMin(cellIdx) + (max - min) / glm::vec3{cellNum};
+    }
+    // GetCellNum() if pos is out of all cells
+    size_t GetCellIndex(const glm::vec3 &pos) const {
+        auto rel = (pos - min) / (max - min);
+        if (rel.x < 0.f || rel.y < 0.f || rel.z < 0.f || rel.x >= 1.f ||
+            rel.y >= 1.f || rel.z >= 1.f)
+            return GetCellNum();
+        glm::uvec3 xyz = glm::min(glm::uvec3{rel * glm::vec3{cellNum}},
+                                  cellNum - (glm::uint)1);
+        return ((size_t)xyz.z * cellNum.y + xyz.y) * cellNum.x + xyz.x;
+    }
+
+    uint64_t GetKey() const { return key; }
+    // Bind to the nodes of an octree, emptying all sets if it differs
+    void Reset(uint64_t key, uint32_t nodeNum) {
+        if (this->key == key && this->nodeNum == nodeNum)
+            return;
+        this->key = key;
+        this->nodeNum = nodeNum;
+        wordNum = (nodeNum + 63) / 64;
+        bits.assign(GetCellNum() * wordNum, 0);
+    }
+    void Add(size_t cellIdx, uint32_t nodeIdx) {
+        bits[cellIdx * wordNum + nodeIdx / 64] |= 1ull << (nodeIdx % 64);
+    }
+    // Node bits of a cell, test with IsIn()
+    const uint64_t *GetSet(size_t cellIdx) const {
+        return bits.data() + cellIdx * wordNum;
+    }
+    static bool IsIn(const uint64_t *set, uint32_t nodeIdx) {
+        return ((set[nodeIdx / 64] >> (nodeIdx % 64)) & 0x1) != 0;
+    }
+
+    // Cells with the same set, common far from the geometry, share it
+    // in the file
+    bool Save(const std::string &path) const {
+        std::vector<uint32_t> cellSets(GetCellNum());
+        std::vector<uint64_t> sets;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> hash2Sets;
+        for (size_t cellIdx = 0; cellIdx < cellSets.size(); ++cellIdx) {
+            auto set = GetSet(cellIdx);
+            auto &candidates = hash2Sets[Hash64(set, sizeof(uint64_t) *
+                                                         wordNum)];
+            auto itr = std::find_if(
+                candidates.begin(), candidates.end(), [&](uint32_t setIdx) {
+                    auto other = sets.data() + (size_t)setIdx * wordNum;
+                    return std::memcmp(other, set,
+                                       sizeof(uint64_t) * wordNum) == 0;
+                });
+            if (itr != candidates.end()) {
+                cellSets[cellIdx] = *itr;
+                continue;
+            }
+            cellSets[cellIdx] = candidates.emplace_back(
+                wordNum == 0 ? 0 : (uint32_t)(sets.size() / wordNum));
+            sets.insert(sets.end(), set, set + wordNum);
+        }
+
+        FileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = FILE_MAGIC;
+        header.version = FILE_VERSION;
+        header.key = key;
+        header.nodeNum = nodeNum;
+        header.setNum = wordNum == 0 ? 0 : (uint32_t)(sets.size() / wordNum);
+        header.cellNum = cellNum;
+        header.min = min;
+        header.max = max;
+
+        std::error_code ec;
+        auto dir = std::filesystem::path(path).parent_path();
+        if (!dir.empty())
+            std::filesystem::create_directories(dir, ec);
+        std::ofstream os(path, std::ios::binary);
+        os.write((const char *)&header, sizeof(header));
+        os.write((const char *)cellSets.data(),
+                 sizeof(uint32_t) * cellSets.size());
+        os.write((const char *)sets.data(), sizeof(uint64_t) * sets.size());
+        return os.good();
+    }
+    // Returns nullptr if the file is missing or corrupted
+    static std::shared_ptr<PVS> Load(const std::string &path) {
+        std::ifstream is(path, std::ios::binary);
+        FileHeader header;
+        if (!is.read((char *)&header, sizeof(header)) ||
+            header.magic != FILE_MAGIC || header.version != FILE_VERSION)
+            return nullptr;
+
+        auto pvs =
+            std::make_shared<PVS>(header.min, header.max, header.cellNum);
+        pvs->Reset(header.key, header.nodeNum);
+        std::vector<uint32_t> cellSets(pvs->GetCellNum());
+        std::vector<uint64_t> sets((size_t)header.setNum * pvs->wordNum);
+        if (!is.read((char *)cellSets.data(),
+                     sizeof(uint32_t) * cellSets.size()) ||
+            !is.read((char *)sets.data(), sizeof(uint64_t) * sets.size()))
+            return nullptr;
+        for (size_t cellIdx = 0; cellIdx < cellSets.size(); ++cellIdx) {
+            if (cellSets[cellIdx] >= header.setNum && pvs->wordNum != 0)
+                return nullptr;
+            auto set = sets.data() + (size_t)cellSets[cellIdx] * pvs->wordNum;
+            std::copy_n(set, pvs->wordNum,
+                        pvs->bits.data() + cellIdx * pvs->wordNum);
+        }
+        return pvs;
+    }
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_PVS_H
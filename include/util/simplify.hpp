@@ -0,0 +1,206 @@
+#ifndef KOUEK_SIMPLIFY_H
+#define KOUEK_SIMPLIFY_H
+
+#include <algorithm>
+#include <cmath>
+
+#include <array>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <util/span.hpp>
+
+namespace kouek {
+
+// Simplify tris, indexing positions, by half-edge collapses in the order
+// of their quadric error, until at most targetNum triangles are left or
+// no collapse is allowed. Kept vertices are never moved, and those on
+// the border of tris are kept, so simplified patches sharing a border
+// still meet. Returns the largest quadric error of the collapses as a
+// distance, estimating how far the result deviates from the input.
+template <typename IdxTy>
+float SimplifyTriangles(std::vector<std::array<IdxTy, 3>> &tris,
+                        StridedSpan<const glm::vec3> positions,
+                        size_t targetNum) {
+    // Symmetric 4x4 matrix, upper triangle by row, weighted by the area
+    // of the planes summed in, followed by the total weight
+    using Quadric = std::array<double, 11>;
+    auto addQuadric = [](Quadric &q, const Quadric &o) {
+        for (uint8_t i = 0; i < 11; ++i)
+            q[i] += o[i];
+    };
+    // The mean squared distance from p to the planes
+    auto evalQuadric = [](const Quadric &q, const glm::vec3 &p) {
+        if (q[10] <= 0.)
+            return 0.;
+        double x = p.x, y = p.y, z = p.z;
+        return (q[0] * x * x + 2. * q[1] * x * y + 2. * q[2] * x * z +
+                2. * q[3] * x + q[4] * y * y + 2. * q[5] * y * z +
+                2. * q[6] * y + q[7] * z * z + 2. * q[8] * z + q[9]) /
+               q[10];
+    };
+    auto getNorm = [](const glm::vec3 &p0, const glm::vec3 &p1,
+                      const glm::vec3 &p2) {
+        return glm::cross(p1 - p0, p2 - p0);
+    };
+
+    // Vertices local to tris
+    std::vector<IdxTy> verts;
+    verts.reserve(tris.size() * 3);
+    for (auto &tri : tris)
+        verts.insert(verts.end(), tri.begin(), tri.end());
+    std::sort(verts.begin(), verts.end());
+    verts.erase(std::unique(verts.begin(), verts.end()), verts.end());
+    auto toLocal = [&](IdxTy vIdx) {
+        return (IdxTy)(std::lower_bound(verts.begin(), verts.end(), vIdx) -
+                       verts.begin());
+    };
+    std::vector<std::array<IdxTy, 3>> locTris(tris.size());
+    for (size_t t = 0; t < tris.size(); ++t)
+        for (uint8_t c = 0; c < 3; ++c)
+            locTris[t][c] = toLocal(tris[t][c]);
+    auto getPos = [&](IdxTy loc) -> const glm::vec3 & {
+        return positions[verts[loc]];
+    };
+
+    std::vector<Quadric> quadrics(verts.size(), Quadric{});
+    std::vector<std::vector<IdxTy>> vertTris(verts.size());
+    for (IdxTy t = 0; t < locTris.size(); ++t) {
+        auto &tri = locTris[t];
+        for (uint8_t c = 0; c < 3; ++c)
+            vertTris[tri[c]].emplace_back(t);
+
+        auto norm = getNorm(getPos(tri[0]), getPos(tri[1]), getPos(tri[2]));
+        auto len = glm::length(norm);
+        if (len <= std::numeric_limits<float>::min())
+            continue;
+        glm::dvec3 n = norm / len;
+        auto d = -glm::dot(n, glm::dvec3(getPos(tri[0])));
+        double w = .5 * len;
+        Quadric q{w * n.x * n.x, w * n.x * n.y, w * n.x * n.z, w * n.x * d,
+                  w * n.y * n.y, w * n.y * n.z, w * n.y * d,   w * n.z * n.z,
+                  w * n.z * d,   w * d * d,     w};
+        for (uint8_t c = 0; c < 3; ++c)
+            addQuadric(quadrics[tri[c]], q);
+    }
+
+    // An edge used by a single triangle is on the border
+    std::vector<bool> locked(verts.size(), false);
+    {
+        std::vector<std::tuple<IdxTy, IdxTy>> edges;
+        edges.reserve(locTris.size() * 3);
+        for (auto &tri : locTris)
+            for (uint8_t c = 0; c < 3; ++c)
+                edges.emplace_back(std::min(tri[c], tri[(c + 1) % 3]),
+                                   std::max(tri[c], tri[(c + 1) % 3]));
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            auto j = i + 1;
+            while (j < edges.size() && edges[j] == edges[i])
+                ++j;
+            if (j - i == 1) {
+                locked[std::get<0>(edges[i])] = true;
+                locked[std::get<1>(edges[i])] = true;
+            }
+            i = j;
+        }
+    }
+
+    // Collapse u into v, popped in ascending cost. Entries are stale once
+    // either vertex has changed since they were pushed.
+    std::vector<uint32_t> vers(verts.size(), 0);
+    std::vector<bool> removedTris(locTris.size(), false);
+    using Entry = std::tuple<double, IdxTy, IdxTy, uint32_t, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    auto pushEdge = [&](IdxTy u, IdxTy v) {
+        if (locked[u])
+            return;
+        auto q = quadrics[u];
+        addQuadric(q, quadrics[v]);
+        heap.emplace(std::max(0., evalQuadric(q, getPos(v))), u, v, vers[u],
+                     vers[v]);
+    };
+    for (auto &tri : locTris)
+        for (uint8_t c = 0; c < 3; ++c) {
+            pushEdge(tri[c], tri[(c + 1) % 3]);
+            pushEdge(tri[(c + 1) % 3], tri[c]);
+        }
+
+    auto triNum = locTris.size();
+    double maxCost = 0.;
+    while (triNum > targetNum && !heap.empty()) {
+        auto [cost, u, v, verU, verV] = heap.top();
+        heap.pop();
+        if (verU != vers[u] || verV != vers[v])
+            continue;
+
+        // Reject collapses flipping or degenerating any triangle left
+        bool valid = true;
+        for (auto t : vertTris[u]) {
+            if (removedTris[t])
+                continue;
+            auto &tri = locTris[t];
+            if (tri[0] == v || tri[1] == v || tri[2] == v)
+                continue;
+            std::array<glm::vec3, 3> ps;
+            for (uint8_t c = 0; c < 3; ++c)
+                ps[c] = getPos(tri[c] == u ? v : tri[c]);
+            auto prevNorm =
+                getNorm(getPos(tri[0]), getPos(tri[1]), getPos(tri[2]));
+            auto norm = getNorm(ps[0], ps[1], ps[2]);
+            if (glm::dot(prevNorm, norm) <= 0.f) {
+                valid = false;
+                break;
+            }
+        }
+        if (!valid)
+            continue;
+
+        maxCost = std::max(maxCost, cost);
+        for (auto t : vertTris[u]) {
+            if (removedTris[t])
+                continue;
+            auto &tri = locTris[t];
+            if (tri[0] == v || tri[1] == v || tri[2] == v) {
+                removedTris[t] = true;
+                --triNum;
+                continue;
+            }
+            for (auto &loc : tri)
+                if (loc == u)
+                    loc = v;
+            vertTris[v].emplace_back(t);
+        }
+        vertTris[u].clear();
+        addQuadric(quadrics[v], quadrics[u]);
+        ++vers[u];
+        ++vers[v];
+
+        // Edges around v have a new cost
+        for (auto t : vertTris[v]) {
+            if (removedTris[t])
+                continue;
+            for (auto w : locTris[t])
+                if (w != v) {
+                    pushEdge(w, v);
+                    pushEdge(v, w);
+                }
+        }
+    }
+
+    tris.clear();
+    for (IdxTy t = 0; t < locTris.size(); ++t)
+        if (!removedTris[t])
+            tris.push_back({verts[locTris[t][0]], verts[locTris[t][1]],
+                            verts[locTris[t][2]]});
+    // As a distance to the planes merged into the kept vertices
+    return (float)std::sqrt(maxCost);
+}
+
+} // namespace kouek
+
+#endif // !KOUEK_SIMPLIFY_H
@@ -0,0 +1,103 @@
+#ifndef KOUEK_SPAN_H
+#define KOUEK_SPAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+#include <vector>
+
+namespace kouek {
+
+// Borrowed, contiguous view of T. The owner must outlive it.
+template <typename T> class Span {
+  private:
+    T *dat = nullptr;
+    size_t num = 0;
+
+  public:
+    Span() = default;
+    Span(T *dat, size_t num) : dat(dat), num(num) {}
+    template <typename U>
+    Span(std::vector<U> &vec) : dat(vec.data()), num(vec.size()) {}
+    template <typename U>
+    Span(const std::vector<U> &vec) : dat(vec.data()), num(vec.size()) {}
+
+    T *data() const { return dat; }
+    size_t size() const { return num; }
+    bool empty() const { return num == 0; }
+    T *begin() const { return dat; }
+    T *end() const { return dat + num; }
+    T &operator[](size_t i) const { return dat[i]; }
+};
+
+// Borrowed view of T at a fixed byte stride, e.g. a member of interleaved
+// structs. The owner must outlive it.
+template <typename T> class StridedSpan {
+  private:
+    using ByteTy =
+        std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+
+    ByteTy *dat = nullptr;
+    size_t num = 0;
+    size_t strd = sizeof(T);
+
+  public:
+    class Iterator {
+      private:
+        ByteTy *ptr;
+        size_t strd;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::remove_const_t<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T *;
+        using reference = T &;
+
+        Iterator(ByteTy *ptr, size_t strd) : ptr(ptr), strd(strd) {}
+        T &operator*() const { return *reinterpret_cast<T *>(ptr); }
+        Iterator &operator++() {
+            ptr += strd;
+            return *this;
+        }
+        Iterator operator++(int) {
+            auto prev = *this;
+            ptr += strd;
+            return prev;
+        }
+        bool operator==(const Iterator &other) const {
+            return ptr == other.ptr;
+        }
+        bool operator!=(const Iterator &other) const {
+            return ptr != other.ptr;
+        }
+    };
+
+    StridedSpan() = default;
+    StridedSpan(T *dat, size_t num, size_t stride = sizeof(T))
+        : dat(reinterpret_cast<ByteTy *>(dat)), num(num), strd(stride) {}
+    StridedSpan(Span<T> span) : StridedSpan(span.data(), span.size()) {}
+    template <typename U>
+    StridedSpan(std::vector<U> &vec) : StridedSpan(vec.data(), vec.size()) {}
+    template <typename U>
+    StridedSpan(const std::vector<U> &vec)
+        : StridedSpan(vec.data(), vec.size()) {}
+
+    T *data() const { return reinterpret_cast<T *>(dat); }
+    size_t size() const { return num; }
+    size_t stride() const { return strd; }
+    bool empty() const { return num == 0; }
+    // Elements are packed as in an array
+    bool IsContiguous() const { return strd == sizeof(T) || num <= 1; }
+    Iterator begin() const { return Iterator(dat, strd); }
+    Iterator end() const { return Iterator(dat + num * strd, strd); }
+    T &operator[](size_t i) const {
+        return *reinterpret_cast<T *>(dat + i * strd);
+    }
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_SPAN_H
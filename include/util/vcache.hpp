@@ -0,0 +1,124 @@
+#ifndef KOUEK_VCACHE_H
+#define KOUEK_VCACHE_H
+
+#include <cmath>
+
+#include <array>
+#include <limits>
+#include <vector>
+
+#include <util/span.hpp>
+
+namespace kouek {
+
+// Order tris, indexing vertices [0, vertNum), for a post-transform LRU
+// cache of CacheSz vertices. Greedily takes the face whose vertices score
+// highest by their position in the simulated cache and the number of
+// faces left using them, after Forsyth's linear-speed vertex cache
+// optimisation. Returns the indices of tris in their new order.
+template <uint32_t CacheSz = 32, typename IdxTy>
+std::vector<uint32_t>
+OptimizeVertexCache(Span<const std::array<IdxTy, 3>> tris, uint32_t vertNum) {
+    static_assert(CacheSz > 3, "Cache holds at least the last face");
+    static constexpr auto NONE = std::numeric_limits<uint32_t>::max();
+    auto triNum = (uint32_t)tris.size();
+
+    // Faces using each vertex as CSR
+    std::vector<uint32_t> offs(vertNum + 1, 0);
+    for (auto &tri : tris)
+        for (auto v : tri)
+            ++offs[v + 1];
+    for (uint32_t v = 0; v < vertNum; ++v)
+        offs[v + 1] += offs[v];
+    std::vector<uint32_t> adjTris(offs.back());
+    {
+        auto fills = offs;
+        for (uint32_t t = 0; t < triNum; ++t)
+            for (auto v : tris[t])
+                adjTris[fills[v]++] = t;
+    }
+
+    // Vertices just used score a little less than those a bit older, so
+    // that strips don't turn back on themselves. Those used by fewer
+    // faces left score more, so that no lonely face is left behind.
+    std::vector<uint32_t> lefts(vertNum);
+    std::vector<int32_t> cachePoses(vertNum, -1);
+    auto score = [&](uint32_t v) {
+        if (lefts[v] == 0)
+            return -1.f;
+        auto s = 2.f / sqrtf((float)lefts[v]);
+        if (auto pos = cachePoses[v]; pos >= 0)
+            s += pos < 3 ? .75f
+                         : powf(1.f - (float)(pos - 3) / (CacheSz - 3), 1.5f);
+        return s;
+    };
+    std::vector<float> vScores(vertNum);
+    std::vector<float> tScores(triNum, 0.f);
+    for (uint32_t v = 0; v < vertNum; ++v) {
+        lefts[v] = offs[v + 1] - offs[v];
+        vScores[v] = score(v);
+    }
+    for (uint32_t t = 0; t < triNum; ++t)
+        for (auto v : tris[t])
+            tScores[t] += vScores[v];
+
+    std::vector<uint32_t> order;
+    order.reserve(triNum);
+    std::vector<bool> dones(triNum, false);
+    // most recently used first, followed by those just evicted
+    std::vector<uint32_t> cache, nextCache;
+    uint32_t best = NONE;
+    uint32_t seed = 0;
+    while (order.size() < triNum) {
+        if (best == NONE) {
+            // None around the cached vertices is left, take the best of all
+            auto bestScore = -1.f;
+            for (auto t = seed; t < triNum; ++t)
+                if (!dones[t] && tScores[t] > bestScore) {
+                    best = t;
+                    bestScore = tScores[t];
+                }
+            while (dones[seed])
+                ++seed;
+        }
+        dones[best] = true;
+        order.emplace_back(best);
+
+        nextCache.clear();
+        for (auto v : tris[best]) {
+            nextCache.emplace_back(v);
+            --lefts[v];
+        }
+        for (auto v : cache)
+            if (v != tris[best][0] && v != tris[best][1] &&
+                v != tris[best][2])
+                nextCache.emplace_back(v);
+        for (uint32_t i = 0; i < nextCache.size(); ++i)
+            cachePoses[nextCache[i]] = i < CacheSz ? (int32_t)i : -1;
+
+        best = NONE;
+        auto bestScore = -1.f;
+        for (auto v : nextCache) {
+            auto delta = score(v) - vScores[v];
+            vScores[v] += delta;
+            for (auto i = offs[v]; i < offs[v + 1]; ++i) {
+                auto t = adjTris[i];
+                if (dones[t])
+                    continue;
+                tScores[t] += delta;
+                if (tScores[t] > bestScore) {
+                    best = t;
+                    bestScore = tScores[t];
+                }
+            }
+        }
+        if (nextCache.size() > CacheSz)
+            nextCache.resize(CacheSz);
+        std::swap(cache, nextCache);
+    }
+    return order;
+}
+
+} // namespace kouek
+
+#endif // !KOUEK_VCACHE_H
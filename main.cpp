@@ -1,8 +1,12 @@
 #include <h_z_buf_ras.h>
+#include <mesh_streamer.h>
 #include <z_buf_ras.h>
 
 #include <iostream>
 
+#include <algorithm>
+#include <cmath>
+
 #include <array>
 
 #include <glad/glad.h>
@@ -34,6 +38,32 @@ int main(int argc, char **argv) {
     parser.set_optional<uint32_t>(
         "r", "rasterizer", 1,
         "Rasterizer Type, 0: Normal, 1: Hierarchical, 2: Simple Hierarchical");
+    parser.set_optional<bool>(
+        "d", "depth-reproj", false,
+        "Seed Occlusion Culling with Reprojected Last Frame Depth");
+    parser.set_optional<std::string>(
+        "c", "cache-dir", "",
+        "Directory to Cache Acceleration Structures in, Empty to Disable");
+    parser.set_optional<float>(
+        "l", "lod-error", 0.f,
+        "Max Screen-Space Error in Pixels of Simplified Nodes, 0 to Disable");
+    parser.set_optional<uint32_t>(
+        "p", "impostor-mb", 0,
+        "Cache Budget in MB of Sprites of Distant Nodes, 0 to Disable");
+    parser.set_optional<std::string>(
+        "v", "pvs", "",
+        "Path of the Potentially Visible Sets Made by pvs, Empty to Disable");
+    parser.set_optional<uint32_t>("i", "instance-num", 1,
+                                  "Instance Num, Laid out on a Grid");
+    parser.set_optional<bool>(
+        "a", "async-load", false,
+        "Load the Model in the Background, Drawing It as It Comes in");
+    parser.set_optional<uint32_t>(
+        "g", "page-mb", 256,
+        "Cache Budget in MB of Faces Read from a Paged Binary Mesh File");
+    parser.set_optional<bool>(
+        "k", "compact", false,
+        "Keep Vertices Quantized in Memory, Decoded as They Are Drawn");
     parser.run_and_exit_if_error();
 
     // GLFW context
@@ -131,6 +161,17 @@ int main(int argc, char **argv) {
         break;
     }
     rasterizer->SetRenderSize(rndrSz);
+    rasterizer->SetDepthReprojection(parser.get<bool>("d"));
+    rasterizer->SetCacheDirectory(parser.get<std::string>("c"));
+    rasterizer->SetLODThreshold(parser.get<float>("l"));
+    rasterizer->SetImpostorCache((size_t)parser.get<uint32_t>("p") << 20,
+                                 glm::radians(1.f), .1f);
+    if (auto pvsPath = parser.get<std::string>("v"); !pvsPath.empty()) {
+        auto pvs = PVS::Load(pvsPath);
+        if (!pvs)
+            std::cout << "PVS: " << pvsPath << " loading failed." << std::endl;
+        rasterizer->SetPVS(pvs);
+    }
 
     // Create texture to be rendered in GL
     glGenTextures(1, &rndrTex);
@@ -177,6 +218,23 @@ int main(int argc, char **argv) {
         (std::string(PROJECT_SOURCE_DIR) + "/screen_quad.fs").c_str());
 
     // Load model
+    std::unique_ptr<MeshStreamer> streamer;
+    auto addInstances = [&](const MeshAsset::AABB &aabb) {
+        auto instNum = parser.get<uint32_t>("i");
+        if (instNum <= 1 || aabb.min.x > aabb.max.x)
+            return;
+        auto spacing =
+            1.2f * std::max(aabb.max.x - aabb.min.x, aabb.max.z - aabb.min.z);
+        auto rowNum = (uint32_t)std::ceil(std::sqrt((float)instNum));
+        for (uint32_t i = 0; i < instNum; ++i)
+            rasterizer->AddInstance(glm::translate(
+                glm::identity<glm::mat4>(),
+                spacing * glm::vec3{(float)(i % rowNum) -
+                                        .5f * (float)(rowNum - 1),
+                                    0.f,
+                                    (float)(i / rowNum) -
+                                        .5f * (float)(rowNum - 1)}));
+    };
 
 //#define TEST_CUBE
 //#define TEST_TRIANGLE
@@ -189,54 +247,68 @@ int main(int argc, char **argv) {
     rasterizer->SetVertexData(positions, colors, indices);
 #else
     auto modelPath = parser.get<std::string>("m");
-    auto positions = std::make_shared<std::vector<glm::vec3>>();
-    auto indices = std::make_shared<std::vector<glm::uint>>();
-    try {
-        kouek::Mesh mesh;
-        mesh.ReadFromFile(modelPath);
-        auto &vs = mesh.GetVS();
-        auto &fvs = mesh.GetFVS();
-        auto &vts = mesh.GetVTS();
-        auto &fvts = mesh.GetFVTS();
-        auto &vns = mesh.GetVNS();
-        auto &fvns = mesh.GetFVNS();
+    // As is if it is written by convert
+    MeshAsset::AABB aabb{glm::vec3{std::numeric_limits<float>::max()},
+                         glm::vec3{std::numeric_limits<float>::lowest()}};
+    if (parser.get<bool>("a")) {
+        std::cout << "Model: " << modelPath << " loading in background"
+                  << std::endl;
+        streamer =
+            MeshStreamer::Create(modelPath, parser.get<std::string>("c"));
+    } else if (auto asset = MeshAsset::Load(
+                   modelPath, (size_t)parser.get<uint32_t>("g") << 20);
+               asset) {
         std::cout << "Model: " << modelPath << std::endl;
-        std::cout << ">> Model Vertices Num: " << vs.size() << std::endl;
-        std::cout << ">> Model Faces Num: " << fvs.size() << std::endl;
-
-        (*positions) = vs;
-        indices->reserve(fvs.size() * 3);
-        for (const auto &idx3 : fvs)
-            for (uint8_t t = 0; t < 3; ++t)
-                indices->emplace_back(idx3[t]);
-        rasterizer->SetVertexData(positions, nullptr, indices);
-
-        std::shared_ptr<std::vector<glm::vec2>> uvs;
-        std::shared_ptr<std::vector<glm::uint>> uvIndices;
-        std::shared_ptr<std::vector<glm::vec3>> norms;
-        std::shared_ptr<std::vector<glm::uint>> nIndices;
-        if (!fvts.empty()) {
-            uvs = std::make_shared<std::vector<glm::vec2>>();
-            uvIndices = std::make_shared<std::vector<glm::uint>>();
-            (*uvs) = vts;
-            for (const auto &idx3 : fvts)
-                for (uint8_t t = 0; t < 3; ++t)
-                    uvIndices->emplace_back(idx3[t]);
+        std::cout << ">> Model Faces Num: " << asset->GetTriangleNum()
+                  << std::endl;
+        if (parser.get<bool>("k"))
+            if (auto compacted = asset->Compact(); compacted)
+                asset = compacted;
+        rasterizer->SetMeshAsset(asset);
+        aabb = asset->GetAABB();
+    } else {
+        try {
+            // Borrowed in place, the mesh lives as long as the asset uses
+            // it
+            auto mesh = std::make_shared<kouek::Mesh>();
+            mesh->ReadFromFile(modelPath);
+            auto vs = mesh->GetVS();
+            auto &fvs = mesh->GetFVS();
+            auto &fvts = mesh->GetFVTS();
+            auto &fvns = mesh->GetFVNS();
+            std::cout << "Model: " << modelPath << std::endl;
+            std::cout << ">> Model Vertices Num: " << vs.size()
+                      << std::endl;
+            std::cout << ">> Model Faces Num: " << fvs.size() << std::endl;
+
+            asset = MeshAsset::Create(
+                vs, {}, Mesh::ToIndices(fvs),
+                fvts.empty() ? StridedSpan<const glm::vec2>()
+                             : mesh->GetVTS(),
+                Mesh::ToIndices(fvts),
+                fvns.empty() ? StridedSpan<const glm::vec3>()
+                             : mesh->GetVNS(),
+                Mesh::ToIndices(fvns), mesh);
+            // Faces laid out by octree leaf, and welded, so that the vertex
+            // stage takes a single index per corner
+            if (auto reordered = asset->Reorder(); reordered)
+                asset = reordered;
+            if (!fvts.empty() || !fvns.empty())
+                if (auto welded = asset->Weld(); welded)
+                    asset = welded;
+            if (parser.get<bool>("k"))
+                if (auto compacted = asset->Compact(); compacted)
+                    asset = compacted;
+            rasterizer->SetMeshAsset(asset);
+            aabb = asset->GetAABB();
+        } catch (std::exception &exp) {
+            std::cout << "Model: " << modelPath << "loading failed."
+                      << std::endl;
+            std::cout << ">> Error: " << exp.what() << std::endl;
         }
-        if (!fvns.empty()) {
-            norms = std::make_shared<std::vector<glm::vec3>>();
-            nIndices = std::make_shared<std::vector<glm::uint>>();
-            (*norms) = vns;
-            for (const auto &idx3 : fvns)
-                for (uint8_t t = 0; t < 3; ++t)
-                    nIndices->emplace_back(idx3[t]);
-        }
-        rasterizer->SetTextureData(uvs, uvIndices, norms, nIndices);
-
-    } catch (std::exception &exp) {
-        std::cout << "Model: " << modelPath << "loading failed." << std::endl;
-        std::cout << ">> Error: " << exp.what() << std::endl;
     }
+
+    addInstances(aabb);
 #endif // TEST_CUBE
 
     // Render Loop
@@ -259,6 +331,32 @@ int main(int argc, char **argv) {
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
+        // Draw what is loaded so far, taking a bounded amount more each
+        // frame, until the whole model replaces it
+        if (streamer) {
+            static constexpr size_t FRAME_TRIANGLE_NUM = 1 << 17;
+            MeshStreamer::Chunk chunk;
+            for (size_t triNum = 0;
+                 triNum < FRAME_TRIANGLE_NUM && streamer->PopChunk(chunk);
+                 triNum += chunk.indices.size() / 3)
+                rasterizer->AppendTriangles(chunk.positions, chunk.colors,
+                                            chunk.indices);
+            if (auto asset = streamer->GetAsset(); asset) {
+                std::cout << "Model: " << modelPath << " loaded" << std::endl;
+                std::cout << ">> Model Faces Num: " << asset->GetTriangleNum()
+                          << std::endl;
+                rasterizer->SetMeshAsset(asset);
+                addInstances(asset->GetAABB());
+                streamer.reset();
+            } else if (streamer->IsDone()) {
+                std::cout << "Model: " << modelPath << "loading failed."
+                          << std::endl;
+                std::cout << ">> Error: " << streamer->GetError()
+                          << std::endl;
+                streamer.reset();
+            }
+        }
+
         rasterizer->Render();
         glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, rndrSz.x, rndrSz.y, GL_RGBA,
                         GL_UNSIGNED_BYTE, rasterizer->GetColorOutput().data());
@@ -0,0 +1,114 @@
+#include <h_z_buf_ras.h>
+
+#include <chrono>
+#include <iostream>
+
+#include <array>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <util/mesh.hpp>
+
+#include <cmdparser.hpp>
+
+using namespace kouek;
+
+int main(int argc, char **argv) {
+    // Command parser
+    cli::Parser parser(argc, argv);
+    parser.set_required<std::string>("m", "model", "Model Path");
+    parser.set_required<std::string>("o", "output", "PVS File Path");
+    parser.set_optional<uint32_t>("n", "cell-num", 4, "Cell Num per Axis");
+    parser.set_optional<float>(
+        "s", "region-scale", 3.f,
+        "Size of the Region Cameras Move in, Relative to the Model AABB");
+    parser.set_optional<uint32_t>(
+        "v", "view-num", 2,
+        "Sampled Eye Positions per Axis in Each Cell, Corners Included");
+    parser.set_optional<uint32_t>("r", "resolution", 512,
+                                  "Render Size of Sampled Views");
+    parser.set_optional<std::string>(
+        "c", "cache-dir", "",
+        "Directory to Cache Acceleration Structures in, Empty to Disable");
+    parser.run_and_exit_if_error();
+
+    // Load model, as is if it is written by convert
+    auto modelPath = parser.get<std::string>("m");
+    auto asset = MeshAsset::Load(modelPath);
+    if (!asset)
+        try {
+            auto mesh = std::make_shared<kouek::Mesh>();
+            mesh->ReadFromFile(modelPath);
+            asset = MeshAsset::Create(mesh->GetVS(), {},
+                                      Mesh::ToIndices(mesh->GetFVS()), {}, {},
+                                      {}, {}, mesh);
+        } catch (std::exception &exp) {
+            std::cout << "Model: " << modelPath << "loading failed."
+                      << std::endl;
+            std::cout << ">> Error: " << exp.what() << std::endl;
+            return 1;
+        }
+
+    // Cells over the model AABB scaled about its center
+    auto [min, max] = asset->GetAABB();
+    auto ctr = .5f * (min + max);
+    auto halfExt = .5f * parser.get<float>("s") * (max - min);
+    PVS pvs(ctr - halfExt, ctr + halfExt,
+            glm::uvec3{parser.get<uint32_t>("n")});
+
+    // Sampled views only see what is in front of them, the PVS of a cell
+    // is that of its sampled eyes looking along all 6 axes. The octree is
+    // traversed in full, without proxies or impostors.
+    auto rasterizer = HierarchicalZBufferRasterizer::Create();
+    glm::uvec2 rndrSz{parser.get<uint32_t>("r")};
+    rasterizer->SetRenderSize(rndrSz);
+    rasterizer->SetCacheDirectory(parser.get<std::string>("c"));
+    rasterizer->SetMeshAsset(asset);
+    rasterizer->SetModel(glm::identity<glm::mat4>());
+    rasterizer->SetProjective(glm::perspectiveFov(
+        glm::radians(90.f), (float)rndrSz.x, (float)rndrSz.y, .01f,
+        2.f * glm::length(2.f * halfExt)));
+    static constexpr std::array<std::array<glm::vec3, 2>, 6> DIR_UPS{
+        std::array<glm::vec3, 2>{glm::vec3{+1.f, 0.f, 0.f},
+                                 glm::vec3{0.f, 1.f, 0.f}},
+        {glm::vec3{-1.f, 0.f, 0.f}, glm::vec3{0.f, 1.f, 0.f}},
+        {glm::vec3{0.f, +1.f, 0.f}, glm::vec3{0.f, 0.f, 1.f}},
+        {glm::vec3{0.f, -1.f, 0.f}, glm::vec3{0.f, 0.f, 1.f}},
+        {glm::vec3{0.f, 0.f, +1.f}, glm::vec3{0.f, 1.f, 0.f}},
+        {glm::vec3{0.f, 0.f, -1.f}, glm::vec3{0.f, 1.f, 0.f}}};
+
+    auto viewNum = std::max(parser.get<uint32_t>("v"), (uint32_t)1);
+    auto t0 = std::chrono::system_clock::now();
+    for (size_t cellIdx = 0; cellIdx < pvs.GetCellNum(); ++cellIdx) {
+        auto cellMin = pvs.GetCellMin(cellIdx);
+        auto cellExt = pvs.GetCellMax(cellIdx) - cellMin;
+        for (uint32_t v = 0; v < viewNum * viewNum * viewNum; ++v) {
+            glm::vec3 t{v % viewNum, v / viewNum % viewNum,
+                        v / viewNum / viewNum};
+            auto eye = viewNum == 1
+                           ? cellMin + .5f * cellExt
+                           : cellMin + cellExt * t / (float)(viewNum - 1);
+            for (auto &[dir, up] : DIR_UPS) {
+                rasterizer->SetView(glm::lookAt(eye, eye + dir, up));
+                rasterizer->Render();
+                rasterizer->RecordPVS(pvs, cellIdx);
+            }
+        }
+    }
+    auto t1 = std::chrono::system_clock::now();
+
+    auto outPath = parser.get<std::string>("o");
+    if (!pvs.Save(outPath)) {
+        std::cout << "PVS: " << outPath << " saving failed." << std::endl;
+        return 1;
+    }
+    std::cout << "PVS: " << outPath << std::endl;
+    std::cout << ">> Cell Num: " << pvs.GetCellNum() << std::endl;
+    std::cout << ">> Duration: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(t1 -
+                                                                       t0)
+                     .count()
+              << " ms" << std::endl;
+
+    return 0;
+}
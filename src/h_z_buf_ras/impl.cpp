@@ -25,330 +25,895 @@ void kouek::HierarchicalZBufferRasterizerImpl::SetRenderSize(
             (size_t)rndrSzMipmap[lvl].x * (size_t)rndrSzMipmap[lvl].y;
         zbufferMipmap[lvl].reserve(resolutionMipmap[lvl]);
     }
+    for (auto &seed : seedMipmap) {
+        seed.clear();
+        seed.shrink_to_fit();
+    }
+    prevDepValid = false;
+    clearImpostors();
 
     sortedET.clear();
     sortedET.resize(rndrSz.y);
 }
 
-void kouek::HierarchicalZBufferRasterizerImpl::SetVertexData(
-    std::shared_ptr<std::vector<glm::vec3>> positions,
-    std::shared_ptr<std::vector<glm::vec3>> colors,
-    std::shared_ptr<std::vector<glm::uint>> indices) {
-    RasterizerImpl::SetVertexData(positions, colors, indices);
-
-    std::vector<decltype(otree)::AABB> aabbs;
-    aabbs.reserve(triangleNum);
-    std::vector<glm::uint> is;
-    is.reserve(triangleNum);
-
-    decltype(otree)::AABB rootAABB;
-    for (uint8_t xyz = 0; xyz < 3; ++xyz) {
-        rootAABB.min[xyz] = std::numeric_limits<float>::max();
-        rootAABB.max[xyz] = std::numeric_limits<float>::min();
-    }
-    for (glm::uint fIdx = 0; fIdx < triangleNum; ++fIdx) {
-        auto idxIdx = fIdx * 3;
-        std::array<glm::uint, 3> vIdx3;
-        vIdx3[0] = (*indices)[idxIdx + 0];
-        vIdx3[1] = (*indices)[idxIdx + 1];
-        vIdx3[2] = (*indices)[idxIdx + 2];
-
-        aabbs.emplace_back();
-        auto &aabb = aabbs.back();
-        for (uint8_t xyz = 0; xyz < 3; ++xyz) {
-            aabb.min[xyz] = std::numeric_limits<float>::max();
-            aabb.max[xyz] = std::numeric_limits<float>::min();
-        }
-        for (uint8_t v = 0; v < 3; ++v)
-            for (uint8_t xyz = 0; xyz < 3; ++xyz) {
-                if (aabb.min[xyz] > (*positions)[vIdx3[v]][xyz])
-                    aabb.min[xyz] = (*positions)[vIdx3[v]][xyz];
-                if (aabb.max[xyz] < (*positions)[vIdx3[v]][xyz])
-                    aabb.max[xyz] = (*positions)[vIdx3[v]][xyz];
-                if (rootAABB.min[xyz] > (*positions)[vIdx3[v]][xyz])
-                    rootAABB.min[xyz] = (*positions)[vIdx3[v]][xyz];
-                if (rootAABB.max[xyz] < (*positions)[vIdx3[v]][xyz])
-                    rootAABB.max[xyz] = (*positions)[vIdx3[v]][xyz];
-            }
-
-        is.emplace_back(fIdx);
-    }
+void kouek::HierarchicalZBufferRasterizerImpl::SetTextureData(
+    StridedSpan<const glm::vec2> uvs, StridedSpan<const glm::uint> uvIndices,
+    StridedSpan<const glm::vec3> norms, StridedSpan<const glm::uint> nIndices,
+    std::shared_ptr<const void> owner) {
+    RasterizerImpl::SetTextureData(uvs, uvIndices, norms, nIndices, owner);
+    clearImpostors();
+}
 
-    otree.Reset(rootAABB);
-    otree.Add(aabbs, is);
-    std::cout << otree << std::endl;
+void kouek::HierarchicalZBufferRasterizerImpl::SetLight(
+    const LightParam &param) {
+    RasterizerImpl::SetLight(param);
+    clearImpostors();
 }
 
-void kouek::HierarchicalZBufferRasterizerImpl::Render() {
-    runPreRasterization();
-    runRasterization();
+void kouek::HierarchicalZBufferRasterizerImpl::RecordPVS(PVS &pvs,
+                                                         size_t cellIdx) {
+    if (!asset || cellIdx >= pvs.GetCellNum())
+        return;
+
+    auto &otree = asset->GetOctree(cacheDir);
+    pvs.Reset(otree.GetNodeHash(), otree.GetNodeNum());
+    // Those of the octree Render() last traversed
+    if (activeAsset != asset.get() ||
+        activeOtreeVer != asset->GetOctreeVersion())
+        return;
+    for (auto &ANs : activeNodes)
+        for (glm::uint nodeIdx = 0; nodeIdx < ANs.size(); ++nodeIdx)
+            if (ANs[nodeIdx])
+                pvs.Add(cellIdx, nodeIdx);
 }
 
+void kouek::HierarchicalZBufferRasterizerImpl::Render() { runRasterization(); }
+
 void kouek::HierarchicalZBufferRasterizerImpl::runRasterization() {
     colorOutput.assign(resolution, glm::zero<glm::u8vec4>());
+    if (!asset) {
+        for (uint8_t lvl = 0; lvl < Z_BUF_MIPMAP_LVL_NUM; ++lvl)
+            zbufferMipmap[lvl].assign(resolutionMipmap[lvl],
+                                      std::numeric_limits<float>::infinity());
+        prevDepValid = false;
+        return;
+    }
+    // Built by the first rasterizer needing it, shared by the others
+    auto &otree = asset->GetOctree(cacheDir);
+    auto paged = asset->IsPaged();
+    if (paged)
+        asset->NextPageFrame();
+    // Nodes are indexed by position, forget them once renumbered
+    if (activeAsset != asset.get() ||
+        activeOtreeVer != asset->GetOctreeVersion()) {
+        activeNodes.clear();
+        clearImpostors();
+        otreeHashValid = false;
+        activeAsset = asset.get();
+        activeOtreeVer = asset->GetOctreeVersion();
+    }
+    // Instances are indexed by position, forget them once added or
+    // cleared. Moved ones keep theirs, and what the reprojected seed
+    // wrongly culls in Phase 1 for them is drawn in Phase 2.
+    if (activeInstVer != instVer) {
+        activeNodes.clear();
+        clearImpostors();
+        prevDepValid = false;
+        activeInstVer = instVer;
+    }
+    if (activeDataVer != asset->GetDataVersion()) {
+        clearImpostors();
+        otreeHashValid = false;
+        activeDataVer = asset->GetDataVersion();
+    }
+    activeNodes.resize(std::max<size_t>(instModels.size(), 1));
+    drawnNodes.resize(activeNodes.size());
+
+    // Reproject before the last frame's depth is cleared
+    auto scnMVP = instModels.empty() ? MVP : P * V;
+    seedValid = depReproj && runDepthReprojection(scnMVP);
+
     for (uint8_t lvl = 0; lvl < Z_BUF_MIPMAP_LVL_NUM; ++lvl)
         zbufferMipmap[lvl].assign(resolutionMipmap[lvl],
                                   std::numeric_limits<float>::infinity());
-#ifdef SHOW_DRAW_FACE_NUM
     glm::uint drawFaceCnt = 0;
-#endif // SHOW_DRAW_FACE_NUM
-    tmpALNs = std::move(activeLeafNodes);
-    for (auto node : tmpALNs)
-        if (depTestOctreeNode(node->looseAABB)) {
-            for (auto &leafDat : node->leafDats)
-                if (v2rs[leafDat.idx].vCnt != 0) {
-                    auto [min, max] = getScrnAABB(v2rs[leafDat.idx]);
-#ifdef SHOW_DRAW_FACE_NUM
-                    ++drawFaceCnt;
-#endif // SHOW_DRAW_FACE_NUM
-                    rasFace(v2rs[leafDat.idx], min, max);
+    auto &nodes = otree.GetNodes();
+    auto &childBounds = otree.GetChildBounds();
+    auto &meshlets = asset->GetMeshlets();
+    auto &mGroups = meshlets.GetGroups();
+    auto &mMeshlets = meshlets.GetMeshlets();
+    auto &mVerts = meshlets.GetVertices();
+    auto &mFaces = meshlets.GetFaces();
+    auto &mTris = meshlets.GetTriangles();
+    auto rasSortedLeafFaces = [&](bool updMipmap) {
+        std::sort(sortedLeafFaces.begin(), sortedLeafFaces.end());
+        for (auto [dep, i] : sortedLeafFaces) {
+            auto [min, max] = getScrnAABB(leafV2Rs[i]);
+            ++drawFaceCnt;
+            rasFace(leafV2Rs[i], min, max, updMipmap);
+        }
+    };
+    // Faces of a paged leaf index the arrays of its page, viewed in place
+    // of the asset's while they are drawn
+    auto rasPage = [&](glm::uint nodeIdx, bool updMipmap) {
+        auto page = asset->GetLeafPage(nodeIdx);
+        if (!page)
+            return;
+        auto views = std::make_tuple(positions, colors, uvs, norms);
+        positions = page->positions;
+        colors = page->colors;
+        uvs = page->uvs;
+        norms = page->norms;
+
+        sortedLeafFaces.clear();
+        auto faceNum = (glm::uint)(page->indices.size() / 3);
+        leafV2Rs.resize(std::max<size_t>(leafV2Rs.size(), faceNum));
+        glm::uint v2rNum = 0;
+        for (glm::uint f = 0; f < faceNum; ++f) {
+            std::array<glm::uint, 3> vIdx3;
+            std::array<glm::uint, 3> uvIdx3;
+            std::array<glm::uint, 3> nIdx3;
+            for (uint8_t t = 0; t < 3; ++t) {
+                vIdx3[t] = page->indices[f * 3 + t];
+                if (!uvs.empty())
+                    uvIdx3[t] = page->uvIndices[f * 3 + t];
+                if (!norms.empty())
+                    nIdx3[t] = page->nIndices[f * 3 + t];
+            }
+            if (auto &v2r = leafV2Rs[v2rNum];
+                processFace(vIdx3, uvIdx3, nIdx3, v2r)) {
+                sortedLeafFaces.emplace_back(
+                    std::min({v2r.vs[0].pos.z, v2r.vs[1].pos.z,
+                              v2r.vs[2].pos.z}),
+                    v2rNum);
+                ++v2rNum;
+            }
+        }
+        rasSortedLeafFaces(updMipmap);
+        std::tie(positions, colors, uvs, norms) = views;
+    };
+    // eye is in Local Space, and backSgn is -1 if the model transform
+    // mirrors, flipping the winding on screen, both once per instance
+    auto rasLeaf = [&](glm::uint nodeIdx, const glm::vec3 &eye,
+                       float backSgn, bool updMipmap) {
+        if (paged) {
+            rasPage(nodeIdx, updMipmap);
+            return;
+        }
+
+        // Cull meshlets as a whole, 8 at a time, before vertex processing
+        // only for faces in those passing, then draw them in approximate
+        // front-to-back order
+        sortedLeafFaces.clear();
+        leafV2Rs.resize(std::max<size_t>(leafV2Rs.size(),
+                                         nodes[nodeIdx].dat));
+        glm::uint v2rNum = 0;
+        auto &group = mGroups[nodeIdx];
+        for (auto b = group.first; b < group.first + group.num; b += 8) {
+            auto laneNum = (uint8_t)std::min<glm::uint>(
+                8, group.first + group.num - b);
+            OctreeTy::ChildBounds bounds;
+            uint8_t msk = 0;
+            uint8_t frontMsk = 0;
+            for (uint8_t l = 0; l < 8; ++l) {
+                auto &m = mMeshlets[b + std::min<uint8_t>(l, laneNum - 1)];
+                for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+                    bounds.min[xyz][l] = m.aabb.min[xyz];
+                    bounds.max[xyz][l] = m.aabb.max[xyz];
+                }
+                if (l >= laneNum)
+                    continue;
+                msk |= 1 << l;
+#ifndef NO_BACK_FACE_CULL
+                // All faces are back- (front-) facing if the angle between
+                // the cone axis and any direction from eye to the bounding
+                // sphere is within 90 degrees minus (plus) the cone angle
+                auto dir = m.ctr - eye;
+                auto dist = glm::length(dir);
+                if (m.coneCos <= 0.f || dist <= m.radius)
+                    continue;
+                auto coneSin = sqrtf(1.f - m.coneCos * m.coneCos);
+                auto sphSin = m.radius / dist;
+                auto sphCos = sqrtf(1.f - sphSin * sphSin);
+                if (m.coneCos * sphCos - coneSin * sphSin <= 0.f)
+                    continue;
+                auto bound = coneSin * sphCos + m.coneCos * sphSin;
+                auto dirCos = backSgn * glm::dot(dir, m.coneAxis) / dist;
+                if (dirCos >= bound)
+                    msk &= ~(1 << l);
+                else if (dirCos <= -bound)
+                    frontMsk |= 1 << l;
+#endif // !NO_BACK_FACE_CULL
+            }
+            // Not in Phase 1, where the mipmap is yet to be built and the
+            // leaf is not drawn again
+            if (msk != 0 && updMipmap)
+                msk = depTestOctreeNodes(bounds, msk);
+
+            for (uint8_t l = 0; l < laneNum; ++l) {
+                if (((msk >> l) & 0x1) == 0)
+                    continue;
+
+                // Shared vertices are transformed once per meshlet
+                auto &m = mMeshlets[b + l];
+                for (uint8_t v = 0; v < m.vertNum; ++v) {
+                    auto pos = getPosition(mVerts[m.vertFirst + v]);
+                    meshletClipPoses[v] = MVP * glm::vec4{pos, 1.f};
+                }
+                auto cullBack = ((frontMsk >> l) & 0x1) == 0;
+                for (auto t = m.triFirst; t < m.triFirst + m.triNum; ++t) {
+                    std::array<glm::vec4, 3> clipPos3{
+                        meshletClipPoses[mTris[t][0]],
+                        meshletClipPoses[mTris[t][1]],
+                        meshletClipPoses[mTris[t][2]]};
+                    if (auto &v2r = leafV2Rs[v2rNum];
+                        processFace(mFaces[t], v2r, &clipPos3, cullBack)) {
+                        sortedLeafFaces.emplace_back(
+                            std::min({v2r.vs[0].pos.z, v2r.vs[1].pos.z,
+                                      v2r.vs[2].pos.z}),
+                            v2rNum);
+                        ++v2rNum;
+                    }
                 }
-            activeLeafNodes.emplace(node);
+            }
+        }
+        rasSortedLeafFaces(updMipmap);
+    };
+
+    // An inner node is drawn as its proxy, instead of descending, once
+    // the proxy's error projects to at most lodThreshold pixels
+    auto *lods =
+        lodThreshold > 0.f && !paged ? &asset->GetLODs() : nullptr;
+    // Distance -> Pixels on screen, per unit of length
+    auto pxPerUnit = P[1][1] * .5f * rndrSz.y;
+    auto useProxy = [&](glm::uint nodeIdx, const glm::vec3 &eye) {
+        auto &node = nodes[nodeIdx];
+        if (!lods || node.isLeaf || lods->proxies[nodeIdx].num == 0)
+            return false;
+        auto dist = glm::distance(
+            eye, glm::clamp(eye, node.looseAABB.min, node.looseAABB.max));
+        return dist > 0.f && lods->proxies[nodeIdx].err * pxPerUnit <=
+                                 lodThreshold * dist;
+    };
+    auto rasProxy = [&](glm::uint nodeIdx, bool updMipmap) {
+        auto &proxy = lods->proxies[nodeIdx];
+        sortedLeafFaces.clear();
+        leafV2Rs.resize(std::max<size_t>(leafV2Rs.size(), proxy.num));
+        glm::uint v2rNum = 0;
+        for (auto f = proxy.first; f < proxy.first + proxy.num; ++f) {
+            auto &vIdx3 = lods->faces[f];
+            std::array<glm::uint, 3> uvIdx3;
+            std::array<glm::uint, 3> nIdx3;
+            for (uint8_t c = 0; c < 3; ++c) {
+                auto corner = lods->vertCorners[vIdx3[c]];
+                if (hasUVs())
+                    uvIdx3[c] = uvIndices[corner];
+                if (!nIndices.empty())
+                    nIdx3[c] = nIndices[corner];
+            }
+            if (auto &v2r = leafV2Rs[v2rNum];
+                processFace(vIdx3, uvIdx3, nIdx3, v2r)) {
+                sortedLeafFaces.emplace_back(
+                    std::min({v2r.vs[0].pos.z, v2r.vs[1].pos.z,
+                              v2r.vs[2].pos.z}),
+                    v2rNum);
+                ++v2rNum;
+            }
+        }
+        rasSortedLeafFaces(updMipmap);
+    };
+
+    // Nodes potentially visible from the cell eye is in, as node bits,
+    // or nullptr to restrict nothing
+    auto getPVSSet = [&](const glm::vec3 &eye) -> const uint64_t * {
+        if (!pvs)
+            return nullptr;
+        if (!otreeHashValid) {
+            otreeHash = otree.GetNodeHash();
+            otreeHashValid = true;
         }
+        auto cellIdx = pvs->GetCellIndex(eye);
+        if (pvs->GetKey() != otreeHash || cellIdx == pvs->GetCellNum())
+            return nullptr;
+        return pvs->GetSet(cellIdx);
+    };
+
+    // Phase 1: draw leaves visible in the last frame without testing,
+    // then build the mipmap from their depth at once. With the seed,
+    // those occluded after the camera moved are skipped already.
+    forEachInstance([&](glm::uint instIdx) {
+        auto &prevANs = activeNodes[instIdx];
+        prevANs.resize(otree.GetNodeNum(), false);
+        auto &drawn = drawnNodes[instIdx];
+        drawn.assign(otree.GetNodeNum(), false);
+        // Camera Space -> Local Space
+        auto VM = V * M;
+        glm::vec3 eye = glm::inverse(VM)[3];
+        auto backSgn = glm::determinant(glm::mat3(VM)) < 0.f ? -1.f : 1.f;
+        auto pvsSet = getPVSSet(eye);
+
+        if (!nodes.empty() && prevANs[0])
+            stk.emplace(0, drawFaceCnt);
+        while (!stk.empty()) {
+            auto [nodeIdx, testedDrawFaceCnt] = stk.top();
+            stk.pop();
+            auto &node = nodes[nodeIdx];
+
+            if (pvsSet && !PVS::IsIn(pvsSet, nodeIdx))
+                continue;
+            if (seedValid && !depTestOctreeNode(node.looseAABB))
+                continue;
 
-    stk.emplace(otree.GetRoot());
-    while (!stk.empty()) {
-        auto node = stk.top();
-        stk.pop();
+            if (node.isLeaf) {
+                rasLeaf(nodeIdx, eye, backSgn, false);
+                drawn[nodeIdx] = true;
+                continue;
+            }
+            if (auto imp = getImpostor(otree, instIdx, nodeIdx, eye)) {
+                drawImpostor(*imp, node.looseAABB, false);
+                // counted as a single face
+                ++drawFaceCnt;
+                drawn[nodeIdx] = true;
+                continue;
+            }
+            if (useProxy(nodeIdx, eye)) {
+                rasProxy(nodeIdx, false);
+                drawn[nodeIdx] = true;
+                continue;
+            }
 
-        if (tmpALNs.find(node) != tmpALNs.end())
-            continue;
+            auto &order = OctreeTy::NEAR_TO_FAR_CHILD_ORDERS
+                [OctreeTy::GetOctant(node, eye)];
+            for (uint8_t i = 8; i > 0; --i)
+                if (auto chIdx = node.first + order[i - 1]; prevANs[chIdx])
+                    stk.emplace(chIdx, drawFaceCnt);
+        }
+    });
+    buildZBufferMipmap(zbufferMipmap);
+    // The seed is not conservative, so Phase 2 tests against drawn depth
+    // only, and nodes it wrongly culled in Phase 1 are drawn there
+    seedValid = false;
+
+    // Phase 2: test the whole octree, including nodes drawn in Phase 1,
+    // so that nodes occluded now are evicted from the active set. Only
+    // nodes not drawn in Phase 1 are drawn, as those active but culled
+    // by the seed there may be visible now.
+    auto runOctree = [&](glm::uint instIdx) {
+        activeNodes[instIdx].assign(otree.GetNodeNum(), false);
+        auto &currANs = activeNodes[instIdx];
+        auto &drawn = drawnNodes[instIdx];
+        auto VM = V * M;
+        glm::vec3 eye = glm::inverse(VM)[3];
+        auto backSgn = glm::determinant(glm::mat3(VM)) < 0.f ? -1.f : 1.f;
+        auto pvsSet = getPVSSet(eye);
+
+        if (!nodes.empty() && !(nodes[0].isLeaf && nodes[0].dat == 0) &&
+            (!pvsSet || PVS::IsIn(pvsSet, 0)) &&
+            depTestOctreeNode(nodes[0].looseAABB))
+            stk.emplace(0, drawFaceCnt);
+        while (!stk.empty()) {
+            auto [nodeIdx, testedDrawFaceCnt] = stk.top();
+            stk.pop();
+            auto &node = nodes[nodeIdx];
+
+            // Nodes in stk have passed the Depth Test, but nearer siblings
+            // drawn since then may occlude them now
+            if (testedDrawFaceCnt != drawFaceCnt &&
+                !depTestOctreeNode(node.looseAABB))
+                continue;
+            currANs[nodeIdx] = true;
 
-        if (node->isLeaf && node->leafDats.empty())
-            continue;
+            if (node.isLeaf) {
+                if (!drawn[nodeIdx])
+                    rasLeaf(nodeIdx, eye, backSgn, true);
+                continue;
+            }
+            // Inner nodes drawn in Phase 1 are drawn as a whole
+            if (drawn[nodeIdx])
+                continue;
+            if (auto imp = getImpostor(otree, instIdx, nodeIdx, eye)) {
+                drawImpostor(*imp, node.looseAABB, true);
+                ++drawFaceCnt;
+                continue;
+            }
+            if (useProxy(nodeIdx, eye)) {
+                rasProxy(nodeIdx, true);
+                continue;
+            }
 
-        // Depth Test
-        if (!depTestOctreeNode(node->looseAABB))
-            continue;
+            // Depth Test on siblings together, skipped for those out of
+            // the PVS
+            auto &bounds = childBounds[node.dat];
+            auto msk = bounds.nonEmptyMsk;
+            if (pvsSet)
+                for (uint8_t i = 0; i < 8; ++i)
+                    if (!PVS::IsIn(pvsSet, node.first + i))
+                        msk &= ~(1 << i);
+            auto passMsk = msk == 0 ? 0 : depTestOctreeNodes(bounds, msk);
+            // Leaves next to those reached are likely reached soon, as the
+            // view moves
+            if (paged)
+                for (uint8_t i = 0; i < 8; ++i)
+                    if ((((msk & ~passMsk) >> i) & 0x1) != 0 &&
+                        nodes[node.first + i].isLeaf)
+                        asset->PrefetchLeafPage(node.first + i);
+            // Visit children from near to far
+            auto &order = OctreeTy::NEAR_TO_FAR_CHILD_ORDERS
+                [OctreeTy::GetOctant(node, eye)];
+            for (uint8_t i = 8; i > 0; --i)
+                if (((passMsk >> order[i - 1]) & 0x1) != 0)
+                    stk.emplace(node.first + order[i - 1], drawFaceCnt);
+        }
+    };
+    if (instModels.empty())
+        runOctree(0);
+    else if (!nodes.empty()) {
+        // Instances are culled hierarchically, near to far, before
+        // descending into the octree of each
+        auto rootAABB = nodes[0].looseAABB;
+        if (instBVHVer != instModelVer ||
+            instBVHRootAABB.min != rootAABB.min ||
+            instBVHRootAABB.max != rootAABB.max) {
+            std::vector<decltype(instBVH)::AABB> aabbs(instModels.size());
+            for (glm::uint instIdx = 0; instIdx < instModels.size();
+                 ++instIdx) {
+                auto &aabb = aabbs[instIdx];
+                aabb.min = glm::vec3{std::numeric_limits<float>::max()};
+                aabb.max = glm::vec3{std::numeric_limits<float>::lowest()};
+                for (uint8_t k = 0; k < 8; ++k) {
+                    glm::vec3 corner{
+                        (k & 0x1) == 0 ? rootAABB.min.x : rootAABB.max.x,
+                        (k & 0x2) == 0 ? rootAABB.min.y : rootAABB.max.y,
+                        (k & 0x4) == 0 ? rootAABB.min.z : rootAABB.max.z};
+                    corner = instModels[instIdx] * glm::vec4{corner, 1.f};
+                    aabb.min = glm::min(aabb.min, corner);
+                    aabb.max = glm::max(aabb.max, corner);
+                }
+            }
+            instBVH.Build(aabbs);
+            instBVHVer = instModelVer;
+            instBVHRootAABB = rootAABB;
+        }
 
-        if (node->isLeaf) {
-            for (auto &leafDat : node->leafDats)
-                if (v2rs[leafDat.idx].vCnt != 0) {
-                    auto [min, max] = getScrnAABB(v2rs[leafDat.idx]);
-#ifdef SHOW_DRAW_FACE_NUM
-                    ++drawFaceCnt;
-#endif // SHOW_DRAW_FACE_NUM
-                    rasFace(v2rs[leafDat.idx], min, max);
+        auto mdl = M;
+        // Camera Space -> World Space
+        glm::vec3 eye = glm::inverse(V)[3];
+        auto &bvhNodes = instBVH.GetNodes();
+        auto &bvhLeafIndices = instBVH.GetLeafIndices();
+        auto depTestBVHNode = [&](const decltype(instBVH)::AABB &aabb) {
+            MVP = P * V;
+            return depTestOctreeNode({aabb.min, aabb.max});
+        };
+        std::vector<bool> visited(instModels.size(), false);
+        if (depTestBVHNode(bvhNodes[0].aabb))
+            instStk.emplace(0, drawFaceCnt);
+        while (!instStk.empty()) {
+            auto [nodeIdx, testedDrawFaceCnt] = instStk.top();
+            instStk.pop();
+            auto &node = bvhNodes[nodeIdx];
+
+            if (testedDrawFaceCnt != drawFaceCnt &&
+                !depTestBVHNode(node.aabb))
+                continue;
+
+            if (node.num != 0) {
+                for (auto i = node.first; i < node.first + node.num; ++i) {
+                    auto instIdx = bvhLeafIndices[i];
+                    visited[instIdx] = true;
+                    M = instModels[instIdx];
+                    MVP = P * V * M;
+                    runOctree(instIdx);
                 }
-            activeLeafNodes.emplace(node);
-        } else
-            for (auto child : node->children)
-                stk.emplace(child);
+                continue;
+            }
+
+            std::array<bool, 2> passes{depTestBVHNode(bvhNodes[node.first].aabb),
+                                       depTestBVHNode(
+                                           bvhNodes[node.first + 1].aabb)};
+            // Push the farther child first
+            auto dist = [&](const decltype(instBVH)::AABB &aabb) {
+                return glm::distance(eye, .5f * (aabb.min + aabb.max));
+            };
+            uint8_t far = dist(bvhNodes[node.first].aabb) <
+                                  dist(bvhNodes[node.first + 1].aabb)
+                              ? 1
+                              : 0;
+            if (passes[far])
+                instStk.emplace(node.first + far, drawFaceCnt);
+            if (passes[1 - far])
+                instStk.emplace(node.first + 1 - far, drawFaceCnt);
+        }
+        for (glm::uint instIdx = 0; instIdx < instModels.size(); ++instIdx)
+            if (!visited[instIdx])
+                activeNodes[instIdx].assign(otree.GetNodeNum(), false);
+
+        M = mdl;
+        MVP = P * V * M;
     }
 
+    prevMVP = scnMVP;
+    prevDepValid = true;
+
 #ifdef SHOW_DRAW_FACE_NUM
     std::cout << ">> draw face num (ras):\t" << drawFaceCnt << std::endl;
 #endif // SHOW_DRAW_FACE_NUM
 }
 
+bool kouek::HierarchicalZBufferRasterizerImpl::runDepthReprojection(
+    const glm::mat4 &scnMVP) {
+    if (!prevDepValid)
+        return false;
+
+    // Last NDC -> Local (World with instances) Space -> Current Clip Space
+    auto reproj = scnMVP * glm::inverse(prevMVP);
+    auto &prevDep = zbufferMipmap[0];
+    auto &seed = seedMipmap[0];
+    seed.assign(resolution, std::numeric_limits<float>::infinity());
+
+    size_t idx = 0;
+    for (glm::uint y = 0; y < rndrSz.y; ++y) {
+        auto ndcY = 2.f * y / rndrSz.y - 1.f;
+        for (glm::uint x = 0; x < rndrSz.x; ++x, ++idx) {
+            if (prevDep[idx] == std::numeric_limits<float>::infinity())
+                continue;
+
+            auto pos =
+                reproj * glm::vec4{2.f * x / rndrSz.x - 1.f, ndcY, prevDep[idx],
+                                   1.f};
+            if (pos.w <= 0.f)
+                continue;
+            pos.w = 1.f / pos.w;
+            pos.x = (pos.x * pos.w + 1.f) * .5f * rndrSz.x;
+            pos.y = (pos.y * pos.w + 1.f) * .5f * rndrSz.y;
+            pos.z *= pos.w;
+            if (pos.x < 0.f || pos.y < 0.f || pos.x >= rndrSz.x ||
+                pos.y >= rndrSz.y)
+                continue;
+
+            // Keep the farthest sample. Pixels without any, including
+            // resampling cracks, are holes that stay at infinity, so the
+            // seed stays conservative. Splatting into the neighbours would
+            // close the cracks, but also occlude what is disoccluded.
+            auto &dep = seed[(size_t)pos.y * rndrSz.x + (size_t)pos.x];
+            if (dep == std::numeric_limits<float>::infinity() || dep < pos.z)
+                dep = pos.z;
+        }
+    }
+    for (uint8_t lvl = 1; lvl < Z_BUF_MIPMAP_LVL_NUM; ++lvl)
+        seedMipmap[lvl].resize(resolutionMipmap[lvl]);
+    buildZBufferMipmap(seedMipmap);
+
+    return true;
+}
+
 bool kouek::HierarchicalZBufferRasterizerImpl::depTestOctreeNode(
-    const decltype(otree)::AABB &aabb) {
-    bool pass = false;
-
-    static constexpr std::array indices{// -Z
-                                        1, 0, 2, 2, 3, 1,
-                                        // +Z
-                                        4, 5, 7, 7, 6, 4,
-                                        // -Y
-                                        0, 1, 5, 5, 4, 0,
-                                        // +Y
-                                        6, 7, 3, 3, 2, 6,
-                                        // -X
-                                        0, 4, 6, 6, 2, 0,
-                                        // +X
-                                        5, 1, 3, 3, 7, 5};
-    std::array<glm::vec4, 8> positions;
-    for (uint8_t v = 0; v < 8; ++v) {
-        positions[v].x = (v & 0x1) == 0 ? aabb.min.x : aabb.max.x;
-        positions[v].y = (v & 0x2) == 0 ? aabb.min.y : aabb.max.y;
-        positions[v].z = (v & 0x4) == 0 ? aabb.min.z : aabb.max.z;
-        positions[v].w = 1.f;
-        positions[v] = MVP * positions[v];
-
-        positions[v].w = 1.f / positions[v].w;
-        positions[v].x *= positions[v].w;
-        positions[v].y *= positions[v].w;
-        positions[v].z *= positions[v].w;
+    const OctreeTy::AABB &aabb) {
+    OctreeTy::ChildBounds bounds;
+    for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+        bounds.min[xyz].fill(aabb.min[xyz]);
+        bounds.max[xyz].fill(aabb.max[xyz]);
     }
+    return depTestOctreeNodes(bounds, 0x1) != 0;
+}
 
-    std::array<glm::uvec2, 3> triangle;
-    for (uint8_t f = 0; f < 6; ++f) {
-        auto i = f * 6;
-        // Face Culling
-        {
-            glm::vec3 v0v1{
-                positions[indices[i + 1]].x - positions[indices[i]].x,
-                positions[indices[i + 1]].y - positions[indices[i]].y,
-                positions[indices[i + 1]].z - positions[indices[i]].z};
-            glm::vec3 v0v2{
-                positions[indices[i + 2]].x - positions[indices[i]].x,
-                positions[indices[i + 2]].y - positions[indices[i]].y,
-                positions[indices[i + 2]].z - positions[indices[i]].z};
-            v0v1 = glm::cross(v0v1, v0v2);
-            if (v0v1.z < 0) // cull back face
-                continue;
+uint8_t kouek::HierarchicalZBufferRasterizerImpl::depTestOctreeNodes(
+    const OctreeTy::ChildBounds &bounds, uint8_t msk) {
+    static constexpr uint8_t LANE_NUM = 8;
+
+    // AABBs are laid out as SoA, one node per lane, so that
+    // the per-corner loops below are vectorized
+    auto &bMin = bounds.min;
+    auto &bMax = bounds.max;
+
+    alignas(32) std::array<float, LANE_NUM> ndcMinX, ndcMinY, ndcMaxX, ndcMaxY,
+        nearestDep;
+    // k = 0,1,2,3,4,5 for L,R,D,T,B,F planes
+    alignas(32) std::array<std::array<int32_t, LANE_NUM>, 6> outCnt;
+    alignas(32) std::array<int32_t, LANE_NUM> straddleNear;
+    ndcMinX.fill(std::numeric_limits<float>::max());
+    ndcMinY.fill(std::numeric_limits<float>::max());
+    ndcMaxX.fill(std::numeric_limits<float>::lowest());
+    ndcMaxY.fill(std::numeric_limits<float>::lowest());
+    nearestDep.fill(std::numeric_limits<float>::max());
+    for (auto &cnt : outCnt)
+        cnt.fill(0);
+    straddleNear.fill(0);
+
+    for (uint8_t v = 0; v < 8; ++v) {
+        auto &px = (v & 0x1) == 0 ? bMin[0] : bMax[0];
+        auto &py = (v & 0x2) == 0 ? bMin[1] : bMax[1];
+        auto &pz = (v & 0x4) == 0 ? bMin[2] : bMax[2];
+        for (uint8_t l = 0; l < LANE_NUM; ++l) {
+            // Local Space -> Clip Space
+            auto x = MVP[0][0] * px[l] + MVP[1][0] * py[l] +
+                     MVP[2][0] * pz[l] + MVP[3][0];
+            auto y = MVP[0][1] * px[l] + MVP[1][1] * py[l] +
+                     MVP[2][1] * pz[l] + MVP[3][1];
+            auto z = MVP[0][2] * px[l] + MVP[1][2] * py[l] +
+                     MVP[2][2] * pz[l] + MVP[3][2];
+            auto w = MVP[0][3] * px[l] + MVP[1][3] * py[l] +
+                     MVP[2][3] * pz[l] + MVP[3][3];
+
+            outCnt[0][l] += x < -w ? 1 : 0;
+            outCnt[1][l] += x > w ? 1 : 0;
+            outCnt[2][l] += y < -w ? 1 : 0;
+            outCnt[3][l] += y > w ? 1 : 0;
+            outCnt[4][l] += z < -w ? 1 : 0;
+            outCnt[5][l] += z > w ? 1 : 0;
+            // A corner in front of the near plane has no valid projection
+            straddleNear[l] |= z < -w ? 1 : 0;
+
+            // Perspective Division
+            auto rhw = w > 0.f ? 1.f / w : 0.f;
+            x *= rhw;
+            y *= rhw;
+            z *= rhw;
+            ndcMinX[l] = std::min(ndcMinX[l], x);
+            ndcMinY[l] = std::min(ndcMinY[l], y);
+            ndcMaxX[l] = std::max(ndcMaxX[l], x);
+            ndcMaxY[l] = std::max(ndcMaxY[l], y);
+            nearestDep[l] = std::min(nearestDep[l], z);
         }
+    }
 
-        for (uint8_t t = 0; t < 2; ++t, i += 3) {
-            glm::uvec2 min{std::numeric_limits<glm::uint>::max()};
-            glm::uvec2 max{std::numeric_limits<glm::uint>::min()};
-
-            auto computeMinMax = [&](uint8_t v, uint8_t lvl) {
-                if (min.x > triangle[v].x)
-                    min.x = triangle[v].x;
-                if (min.y > triangle[v].y)
-                    min.y = triangle[v].y;
-                if (max.x < triangle[v].x)
-                    max.x = triangle[v].x;
-                if (max.y < triangle[v].y)
-                    max.y = triangle[v].y;
-
-                if (max.x >= rndrSzMipmap[lvl].x && rndrSzMipmap[lvl].x != 0)
-                    max.x = rndrSzMipmap[lvl].x - 1;
-                if (max.y >= rndrSzMipmap[lvl].y && rndrSzMipmap[lvl].y != 0)
-                    max.y = rndrSzMipmap[lvl].y - 1;
-            };
+    uint8_t passMsk = 0;
+    for (uint8_t l = 0; l < LANE_NUM; ++l) {
+        if (((msk >> l) & 0x1) == 0)
+            continue;
 
-            for (uint8_t v = 0; v < 3; ++v) {
-                triangle[v].x = (glm::uint)roundf(
-                    (positions[indices[i + v]].x + 1.f) * .5f * rndrSz.x);
-                triangle[v].y = (glm::uint)roundf(
-                    (positions[indices[i + v]].y + 1.f) * .5f * rndrSz.y);
-                computeMinMax(v, 0);
+        // Frustum Culling
+        bool culled = false;
+        for (uint8_t k = 0; k < 6; ++k)
+            if (outCnt[k][l] == 8) {
+                culled = true;
+                break;
             }
+        if (culled)
+            continue;
+        // Straddling the near plane, the box may cover the whole screen
+        if (straddleNear[l] != 0) {
+            passMsk |= 1 << l;
+            continue;
+        }
 
-            auto lvl = getMipmapLvl(min, max);
-            if (lvl == 0)
-                return true;
-            min.x = std::numeric_limits<glm::uint>::max();
-            min.y = std::numeric_limits<glm::uint>::max();
-            max.x = std::numeric_limits<glm::uint>::min();
-            max.y = std::numeric_limits<glm::uint>::min();
-
-            for (uint8_t v = 0; v < 3; ++v) {
-                triangle[v].x = triangle[v].x >> lvl;
-                triangle[v].y = triangle[v].y >> lvl;
-                computeMinMax(v, lvl);
-            }
+        // NDC -> Screen Space, clamped to the viewport
+        glm::uvec2 min{(glm::uint)std::max(
+                           0.f, floorf((ndcMinX[l] + 1.f) * .5f * rndrSz.x)),
+                       (glm::uint)std::max(
+                           0.f, floorf((ndcMinY[l] + 1.f) * .5f * rndrSz.y))};
+        glm::uvec2 max{(glm::uint)std::max(
+                           0.f, floorf((ndcMaxX[l] + 1.f) * .5f * rndrSz.x)),
+                       (glm::uint)std::max(
+                           0.f, floorf((ndcMaxY[l] + 1.f) * .5f * rndrSz.y))};
+        for (uint8_t xy = 0; xy < 2; ++xy)
+            if (max[xy] >= rndrSz[xy])
+                max[xy] = rndrSz[xy] - 1;
+
+        // Choose the level on which the rect covers at most 2x2 texels
+        auto ext = std::max(max.x - min.x, max.y - min.y);
+        uint8_t lvl = 0;
+        while ((ext >> lvl) != 0 && lvl < Z_BUF_MIPMAP_LVL_NUM - 1)
+            ++lvl;
+        for (uint8_t xy = 0; xy < 2; ++xy) {
+            min[xy] = min[xy] >> lvl;
+            max[xy] = max[xy] >> lvl;
+        }
+        // Odd render sizes leave the last row/column out of coarser levels
+        if (max.x >= rndrSzMipmap[lvl].x || max.y >= rndrSzMipmap[lvl].y) {
+            passMsk |= 1 << l;
+            continue;
+        }
 
-            std::array<uint8_t, 3> v3;
-            v3[0] = 0;
-            while (v3[0] < 3) {
-                v3[1] = v3[0] + 1;
-                if (v3[1] == 3)
-                    v3[1] = 0;
-                v3[2] = v3[1] + 1;
-                if (v3[2] == 3)
-                    v3[2] = 0;
-
-                if (triangle[v3[0]].y != triangle[v3[1]].y) {
-                    uint8_t bot = 0, top = 1;
-                    if (triangle[v3[0]].y > triangle[v3[1]].y) {
-                        bot = 1;
-                        top = 0;
-                    }
-                    EdgeNode node;
-                    node.v2[bot] = v3[0];
-                    node.v2[top] = v3[1];
-                    node.ymax = triangle[top].y;
-                    if (node.ymax >= rndrSzMipmap[lvl].y)
-                        node.ymax = rndrSzMipmap[lvl].y - 1;
-                    node.coeff = 0.f;
-                    node.dcoeff = triangle[v3[top]].y - triangle[v3[bot]].y;
-                    node.x = triangle[v3[bot]].x;
-                    node.dx = (triangle[v3[top]].x > triangle[v3[bot]].x
-                                   ? (float)(triangle[v3[top]].x -
-                                             triangle[v3[bot]].x)
-                                   : -(float)(triangle[v3[bot]].x -
-                                              triangle[v3[top]].x)) /
-                              node.dcoeff;
-                    node.dcoeff = 1.f / node.dcoeff;
-
-                    auto ymin = triangle[v3[bot]].y;
-                    // Corner Case:
-                    //    /|
-                    // P./_|
-                    //   \ |
-                    //    \|
-                    // Here, the horizontal segment won't be drawn
-                    // if the point P is counted twice
-                    auto ynn = (glm::uint)roundf(triangle[v3[2]].y);
-                    ynn = ynn >> lvl;
-                    if (ynn < ymin)
-                        ++ymin;
-                    if (ymin >= rndrSzMipmap[lvl].y)
-                        ymin = rndrSzMipmap[lvl].y - 1;
-                    auto itr = std::lower_bound(sortedET[ymin].begin(),
-                                                sortedET[ymin].end(), node);
-                    sortedET[ymin].insert(itr, node);
+        // The seed is resampled point-wise, only trust it once it is
+        // reduced over whole texels
+        auto useSeed = seedValid && lvl != 0;
+        auto dep = nearestDep[l];
+        size_t rowLftIdx = (size_t)min.y * (size_t)rndrSzMipmap[lvl].x;
+        for (glm::uint y = min.y; y <= max.y;
+             ++y, rowLftIdx += rndrSzMipmap[lvl].x)
+            for (glm::uint x = min.x; x <= max.x; ++x)
+                if (dep <= zbufferMipmap[lvl][rowLftIdx + x] &&
+                    (!useSeed || dep <= seedMipmap[lvl][rowLftIdx + x])) {
+                    passMsk |= 1 << l;
+                    goto FINAL_PER_LANE;
                 }
+    FINAL_PER_LANE:;
+    }
 
-                ++v3[0];
-            }
+    return passMsk;
+}
 
-            // Scanline Rendering
-            size_t rowLftIdx = (size_t)min.y * (size_t)rndrSzMipmap[lvl].x;
-            glm::uint y;
-            for (y = min.y; y <= max.y; ++y, rowLftIdx += rndrSzMipmap[lvl].x) {
-                for (auto &edge : activeEL) {
-                    edge.x += edge.dx;
-                    edge.coeff += edge.dcoeff;
-                }
-                activeEL.splice(activeEL.begin(), sortedET[y]);
-                if (activeEL.empty())
-                    continue;
-                activeEL.sort();
-
-                // there are only 2 elements in activeEL
-                // since the primitive is convex
-                auto L = activeEL.begin();
-                auto R = L;
-                std::advance(R, 1);
-                if (R == activeEL.end())
-                    goto FINAL_PER_Y;
-
-                std::array oneMinusCoeff2{1.f - L->coeff, 1.f - R->coeff};
-                std::array dep2{
-                    positions[indices[i + L->v2[0]]].z * oneMinusCoeff2[0] +
-                        positions[indices[i + L->v2[1]]].z * L->coeff,
-                    positions[indices[i + R->v2[0]]].z * oneMinusCoeff2[1] +
-                        positions[indices[i + R->v2[1]]].z * R->coeff};
-                std::array LRLimit{(glm::uint)roundf(L->x),
-                                   (glm::uint)roundf(R->x)};
-                if (LRLimit[1] >= max.x && max.x != 0)
-                    LRLimit[1] = max.x - 1;
-
-                auto scnLnCoeff = 0.f;
-                auto scnLnDCoeff = LRLimit[1] == LRLimit[0]
-                                       ? 0
-                                       : 1.f / (float)(LRLimit[1] - LRLimit[0]);
-                for (glm::uint x = LRLimit[0]; x <= LRLimit[1];
-                     ++x, scnLnCoeff += scnLnDCoeff) {
-                    auto oneMinusScnLnCoeff = 1.f - scnLnCoeff;
-                    auto dep =
-                        dep2[0] * oneMinusScnLnCoeff + dep2[1] * scnLnCoeff;
-                    if (dep <= zbufferMipmap[lvl][rowLftIdx + x]) {
-                        pass = true;
-                        goto FINAL_PER_TRIANGLE;
-                    }
-                }
+bool kouek::HierarchicalZBufferRasterizerImpl::projectAABB(
+    const OctreeTy::AABB &aabb, glm::vec2 &min, glm::vec2 &max) {
+    min = glm::vec2{std::numeric_limits<float>::max()};
+    max = glm::vec2{std::numeric_limits<float>::lowest()};
+    for (uint8_t k = 0; k < 8; ++k) {
+        glm::vec4 pos{(k & 0x1) == 0 ? aabb.min.x : aabb.max.x,
+                      (k & 0x2) == 0 ? aabb.min.y : aabb.max.y,
+                      (k & 0x4) == 0 ? aabb.min.z : aabb.max.z, 1.f};
+        // Local Space -> Clip Space
+        pos = MVP * pos;
+        if (pos.z < -pos.w || pos.w <= 0.f)
+            return false;
+
+        // NDC -> Screen Space
+        glm::vec2 xy{(pos.x / pos.w + 1.f) * .5f * rndrSz.x,
+                     (pos.y / pos.w + 1.f) * .5f * rndrSz.y};
+        min = glm::min(min, xy);
+        max = glm::max(max, xy);
+    }
+    return true;
+}
+
+const kouek::HierarchicalZBufferRasterizerImpl::Impostor *
+kouek::HierarchicalZBufferRasterizerImpl::getImpostor(const OctreeTy &otree,
+                                                      glm::uint instIdx,
+                                                      glm::uint nodeIdx,
+                                                      const glm::vec3 &eye) {
+    auto &nodes = otree.GetNodes();
+    auto &node = nodes[nodeIdx];
+    // Subtrees of a paged asset are only drawn through culling
+    if (impostorBudget == 0 || node.isLeaf || asset->IsPaged())
+        return nullptr;
+
+    // Only nodes small and wholly on screen, so that the sprite holds all
+    // of the node while the view is within the tolerance
+    glm::vec2 min, max;
+    if (!projectAABB(node.looseAABB, min, max))
+        return nullptr;
+    auto ext = std::max(max.x - min.x, max.y - min.y);
+    if (ext > IMPOSTOR_MAX_SZ || min.x < 0.f || min.y < 0.f ||
+        max.x >= rndrSz.x - 1 || max.y >= rndrSz.y - 1)
+        return nullptr;
+    auto dir = .5f * (node.looseAABB.min + node.looseAABB.max) - eye;
+    if (auto len = glm::length(dir); len > 0.f)
+        dir /= len;
+    else
+        return nullptr;
+
+    auto key = ((uint64_t)instIdx << 32) | nodeIdx;
+    if (auto itr = impostors.find(key); itr != impostors.end()) {
+        auto &imp = itr->second;
+        if (glm::dot(dir, imp.dir) >= cosf(impostorAngTol) &&
+            fabsf(ext / imp.ext - 1.f) <= impostorSizeTol) {
+            impostorLRU.splice(impostorLRU.begin(), impostorLRU, imp.lruItr);
+            return &imp;
+        }
+        impostorByteNum -= imp.GetByteNum();
+        impostorLRU.erase(imp.lruItr);
+        impostors.erase(itr);
+    }
 
-            FINAL_PER_Y:
-                for (R = activeEL.begin(); R != activeEL.end();)
-                    if (R->ymax == y)
-                        activeEL.erase(R++);
-                    else
-                        ++R;
+    // Capture the sprite with texels on the pixels covered now
+    glm::uvec2 pxMin{floorf(min.x), floorf(min.y)};
+    glm::uvec2 pxMax{ceilf(max.x), ceilf(max.y)};
+    Impostor imp;
+    imp.dir = dir;
+    imp.ext = std::max(ext, 1.f);
+    imp.sz = pxMax - pxMin + (glm::uint)1;
+    auto texelNum = (size_t)imp.sz.x * imp.sz.y;
+    imp.colors.assign(texelNum, glm::zero<glm::u8vec4>());
+    imp.deps.assign(texelNum, std::numeric_limits<float>::infinity());
+    if (imp.GetByteNum() > impostorBudget)
+        return nullptr;
+    while (impostorByteNum + imp.GetByteNum() > impostorBudget) {
+        auto itr = impostors.find(impostorLRU.back());
+        impostorByteNum -= itr->second.GetByteNum();
+        impostors.erase(itr);
+        impostorLRU.pop_back();
+    }
+
+    // Screen Space -> Sprite Space is a scale and offset, applied to NDC
+    glm::vec2 scale = glm::vec2{rndrSz} / glm::vec2{imp.sz};
+    glm::vec2 offs = (glm::vec2{rndrSz} - 2.f * glm::vec2{pxMin}) /
+                         glm::vec2{imp.sz} -
+                     1.f;
+    auto crop = glm::identity<glm::mat4>();
+    crop[0][0] = scale.x;
+    crop[1][1] = scale.y;
+    crop[3][0] = offs.x;
+    crop[3][1] = offs.y;
+    imp.MVP = crop * MVP;
+
+    // Draw the subtree alone, without culling, into the sprite
+    auto scrnMVP = MVP;
+    auto scrnSz = rndrSz;
+    MVP = imp.MVP;
+    rndrSz = rndrSzMipmap[0] = imp.sz;
+    colorOutput.swap(imp.colors);
+    zbufferMipmap[0].swap(imp.deps);
+    leafV2Rs.resize(std::max<size_t>(leafV2Rs.size(), 1));
+    auto &leafIndices = otree.GetLeafIndices();
+    std::vector<glm::uint> subStk{nodeIdx};
+    while (!subStk.empty()) {
+        auto &sub = nodes[subStk.back()];
+        subStk.pop_back();
+        if (!sub.isLeaf) {
+            for (uint8_t i = 0; i < 8; ++i)
+                subStk.emplace_back(sub.first + i);
+            continue;
+        }
+        for (auto i = sub.first; i < sub.first + sub.dat; ++i)
+            if (processFace(leafIndices[i], leafV2Rs[0])) {
+                auto [fMin, fMax] = getScrnAABB(leafV2Rs[0]);
+                rasFace(leafV2Rs[0], fMin, fMax, false);
             }
+    }
+    colorOutput.swap(imp.colors);
+    zbufferMipmap[0].swap(imp.deps);
+    rndrSz = rndrSzMipmap[0] = scrnSz;
+    MVP = scrnMVP;
+
+    impostorLRU.emplace_front(key);
+    imp.lruItr = impostorLRU.begin();
+    impostorByteNum += imp.GetByteNum();
+    return &impostors.emplace(key, std::move(imp)).first->second;
+}
+
+void kouek::HierarchicalZBufferRasterizerImpl::drawImpostor(
+    const Impostor &imp, const OctreeTy::AABB &aabb, bool updMipmap) {
+    glm::vec2 min, max;
+    projectAABB(aabb, min, max);
+    glm::uvec2 pxMin{std::max(0.f, floorf(min.x)),
+                     std::max(0.f, floorf(min.y))};
+    glm::uvec2 pxMax{std::max(0.f, ceilf(max.x)),
+                     std::max(0.f, ceilf(max.y))};
+    for (uint8_t xy = 0; xy < 2; ++xy)
+        if (pxMax[xy] >= rndrSz[xy])
+            pxMax[xy] = rndrSz[xy] - 1;
+
+    // Each pixel is mapped to the sprite through the plane facing the
+    // capturing eye at the node center, then placed at the depth it has
+    // there. Unlike splatting sprite texels, this leaves no cracks.
+    auto invMVP = glm::inverse(MVP);
+    auto ctr = .5f * (aabb.min + aabb.max);
+    // The plane in NDC, where its depth is affine in x and y
+    auto plane = glm::transpose(invMVP) *
+                 glm::vec4{imp.dir, -glm::dot(imp.dir, ctr)};
+    if (plane.z == 0.f)
+        return;
+    // NDC on the plane -> Local Space -> Clip Space of the sprite, which
+    // is linear in x and y
+    auto toSprite = imp.MVP * invMVP;
+    auto sprX = toSprite[0] - toSprite[2] * (plane.x / plane.z);
+    auto sprY = toSprite[1] - toSprite[2] * (plane.y / plane.z);
+    auto spr1 = toSprite[3] - toSprite[2] * (plane.w / plane.z);
+    // Sprite NDC -> Local Space -> Clip Space, by row
+    auto reproj = glm::transpose(MVP * glm::inverse(imp.MVP));
+
+    auto dSprX = sprX * (2.f / rndrSz.x);
+    for (glm::uint y = pxMin.y; y <= pxMax.y; ++y) {
+        auto rowLftIdx = (size_t)y * rndrSz.x;
+        auto spr = sprX * (2.f * pxMin.x / rndrSz.x - 1.f) +
+                   sprY * (2.f * y / rndrSz.y - 1.f) + spr1;
+        for (glm::uint x = pxMin.x; x <= pxMax.x; ++x, spr += dSprX) {
+            if (spr.w <= 0.f)
+                continue;
+            auto sx = roundf((spr.x / spr.w + 1.f) * .5f * imp.sz.x);
+            auto sy = roundf((spr.y / spr.w + 1.f) * .5f * imp.sz.y);
+            if (sx < 0.f || sy < 0.f || sx >= imp.sz.x || sy >= imp.sz.y)
+                continue;
+            auto texelIdx = (size_t)sy * imp.sz.x + (size_t)sx;
+            if (imp.deps[texelIdx] == std::numeric_limits<float>::infinity())
+                continue;
 
-        FINAL_PER_TRIANGLE:
-            activeEL.clear();
-            for (; y <= max.y; ++y)
-                sortedET[y].clear();
-            if (pass)
-                return true;
+            glm::vec4 sprNDC{2.f * sx / imp.sz.x - 1.f,
+                             2.f * sy / imp.sz.y - 1.f, imp.deps[texelIdx],
+                             1.f};
+            auto dep =
+                glm::dot(reproj[2], sprNDC) / glm::dot(reproj[3], sprNDC);
+            if (dep >= zbufferMipmap[0][rowLftIdx + x])
+                continue;
+            zbufferMipmap[0][rowLftIdx + x] = dep;
+            if (updMipmap)
+                updateZBufferMipmap(x, y);
+            colorOutput[rowLftIdx + x] = imp.colors[texelIdx];
         }
     }
+}
 
-    return false;
+void kouek::HierarchicalZBufferRasterizerImpl::clearImpostors() {
+    impostors.clear();
+    impostorLRU.clear();
+    impostorByteNum = 0;
 }
@@ -4,29 +4,109 @@
 #include "../s_h_z_buf_ras/impl.h"
 #include <h_z_buf_ras.h>
 
-#include <util/octree.hpp>
+#include <list>
+#include <unordered_map>
+
+#include <util/bvh.hpp>
 
 namespace kouek {
 
 class HierarchicalZBufferRasterizerImpl : public SimpleHZBufferRasterizerImpl,
                                           public HierarchicalZBufferRasterizer {
   private:
-    Octree<glm::uint, 512, 10> otree;
-    std::stack<decltype(otree)::Node *> stk;
-    std::unordered_set<decltype(otree)::Node *> activeLeafNodes;
-    std::unordered_set<decltype(otree)::Node *> tmpALNs;
+    using OctreeTy = MeshAssetImpl::OctreeTy;
+
+    // the octree of asset that activeNodes are indexed by
+    const MeshAssetImpl *activeAsset = nullptr;
+    glm::uint activeOtreeVer = 0;
+    // node index with the drawn face num when it passed the Depth Test
+    std::stack<std::tuple<glm::uint, glm::uint>> stk;
+    // vertex processing of a single leaf, for faces not culled in it
+    std::vector<V2R> leafV2Rs;
+    std::array<glm::vec4, MeshAssetImpl::MeshletsTy::MAX_VERT_NUM>
+        meshletClipPoses;
+    std::vector<std::tuple<float, glm::uint>> sortedLeafFaces;
+
+    // last frame's depth reprojected to this frame, for culling only
+    bool prevDepValid = false;
+    bool seedValid = false;
+    // local (world with instances) to clip space of the last frame
+    glm::mat4 prevMVP;
+    std::array<std::vector<float>, Z_BUF_MIPMAP_LVL_NUM> seedMipmap;
+    // nodes passing the Depth Test in the last frame,
+    // by instance then node index
+    std::vector<std::vector<bool>> activeNodes;
+    // nodes drawn in Phase 1 of this frame, by instance then node index
+    std::vector<std::vector<bool>> drawnNodes;
+    glm::uint activeInstVer = 0;
+
+    // instances in world space, rebuilt when they or the octree change
+    BVH<glm::uint, 2> instBVH;
+    glm::uint instBVHVer = 0;
+    OctreeTy::AABB instBVHRootAABB;
+    std::stack<std::tuple<glm::uint, glm::uint>> instStk;
+
+    // Color and depth of an inner node's subtree drawn alone
+    struct Impostor {
+        // Local Space -> Clip Space of the sprite, when captured
+        glm::mat4 MVP;
+        // direction from eye to the node center, and its size on screen
+        // in pixels, when captured
+        glm::vec3 dir;
+        float ext;
+        glm::uvec2 sz;
+        std::vector<glm::u8vec4> colors;
+        std::vector<float> deps;
+        std::list<uint64_t>::iterator lruItr;
+
+        size_t GetByteNum() const {
+            return sizeof(Impostor) +
+                   colors.size() * (sizeof(glm::u8vec4) + sizeof(float));
+        }
+    };
+    // Larger nodes are close enough to be worth drawing in full
+    static constexpr glm::uint IMPOSTOR_MAX_SZ = 128;
+    // by instance index << 32 | node index
+    std::unordered_map<uint64_t, Impostor> impostors;
+    // keys of impostors, the most recently used first
+    std::list<uint64_t> impostorLRU;
+    size_t impostorByteNum = 0;
+
+    // the vertex data version of asset, below which impostors are stale
+    glm::uint activeDataVer = 0;
+    // GetNodeHash() of the octree, to match PVS with
+    uint64_t otreeHash = 0;
+    bool otreeHashValid = false;
 
   public:
     virtual void SetRenderSize(const glm::uvec2 &rndrSz) override;
-    virtual void
-    SetVertexData(std::shared_ptr<std::vector<glm::vec3>> positions,
-                  std::shared_ptr<std::vector<glm::vec3>> colors,
-                  std::shared_ptr<std::vector<glm::uint>> indices) override;
+    using RasterizerImpl::SetTextureData;
+    virtual void SetTextureData(StridedSpan<const glm::vec2> uvs,
+                                StridedSpan<const glm::uint> uvIndices,
+                                StridedSpan<const glm::vec3> norms,
+                                StridedSpan<const glm::uint> nIndices,
+                                std::shared_ptr<const void> owner) override;
+    virtual void SetLight(const LightParam &param) override;
+    virtual void RecordPVS(PVS &pvs, size_t cellIdx) override;
     virtual void Render() override;
 
   private:
     void runRasterization();
-    bool depTestOctreeNode(const decltype(otree)::AABB &aabb);
+    bool runDepthReprojection(const glm::mat4 &scnMVP);
+    // Screen Space rect of aabb, false if it straddles the near plane
+    bool projectAABB(const OctreeTy::AABB &aabb, glm::vec2 &min,
+                     glm::vec2 &max);
+    // The impostor of an inner node for the current view, captured anew if
+    // the cached one is out of tolerance, or nullptr if the node is better
+    // drawn in full
+    const Impostor *getImpostor(const OctreeTy &otree, glm::uint instIdx,
+                                glm::uint nodeIdx, const glm::vec3 &eye);
+    void drawImpostor(const Impostor &imp, const OctreeTy::AABB &aabb,
+                      bool updMipmap);
+    void clearImpostors();
+    bool depTestOctreeNode(const OctreeTy::AABB &aabb);
+    uint8_t depTestOctreeNodes(const OctreeTy::ChildBounds &bounds,
+                               uint8_t msk);
 };
 
 } // namespace kouek
@@ -0,0 +1,1757 @@
+#include "impl.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <atomic>
+#include <condition_variable>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+
+#include <util/codec.hpp>
+#include <util/vcache.hpp>
+
+std::shared_ptr<const kouek::MeshAsset> kouek::MeshAsset::Create(
+    std::shared_ptr<std::vector<glm::vec3>> positions,
+    std::shared_ptr<std::vector<glm::vec3>> colors,
+    std::shared_ptr<std::vector<glm::uint>> indices,
+    std::shared_ptr<std::vector<glm::vec2>> uvs,
+    std::shared_ptr<std::vector<glm::uint>> uvIndices,
+    std::shared_ptr<std::vector<glm::vec3>> norms,
+    std::shared_ptr<std::vector<glm::uint>> nIndices) {
+    return std::make_shared<MeshAssetImpl>(positions, colors, indices, uvs,
+                                           uvIndices, norms, nIndices);
+}
+
+std::shared_ptr<const kouek::MeshAsset> kouek::MeshAsset::Create(
+    StridedSpan<const glm::vec3> positions,
+    StridedSpan<const glm::vec3> colors, StridedSpan<const glm::uint> indices,
+    StridedSpan<const glm::vec2> uvs, StridedSpan<const glm::uint> uvIndices,
+    StridedSpan<const glm::vec3> norms, StridedSpan<const glm::uint> nIndices,
+    std::shared_ptr<const void> owner) {
+    return std::make_shared<MeshAssetImpl>(positions, colors, indices, uvs,
+                                           uvIndices, norms, nIndices, owner);
+}
+
+std::shared_ptr<const kouek::MeshAsset>
+kouek::MeshAsset::Load(const std::string &path, size_t pageBudget) {
+    return MeshAssetImpl::Load(path, pageBudget);
+}
+
+kouek::MeshAssetImpl::MeshAssetImpl(
+    std::shared_ptr<std::vector<glm::vec3>> positions,
+    std::shared_ptr<std::vector<glm::vec3>> colors,
+    std::shared_ptr<std::vector<glm::uint>> indices,
+    std::shared_ptr<std::vector<glm::vec2>> uvs,
+    std::shared_ptr<std::vector<glm::uint>> uvIndices,
+    std::shared_ptr<std::vector<glm::vec3>> norms,
+    std::shared_ptr<std::vector<glm::uint>> nIndices)
+    : posVec(positions), colVec(colors), idxVec(indices), uvVec(uvs),
+      uvIdxVec(uvIndices), normVec(norms), nIdxVec(nIndices) {
+    if (!posVec)
+        posVec = std::make_shared<std::vector<glm::vec3>>();
+    if (!idxVec)
+        idxVec = std::make_shared<std::vector<glm::uint>>();
+    this->positions = *posVec;
+    this->indices = *idxVec;
+    auto share = [&](auto &view, const auto &vec) {
+        if (!vec)
+            return;
+        view = *vec;
+        owners.emplace_back(vec);
+    };
+    share(this->colors, colVec);
+    share(this->uvs, uvs);
+    share(this->uvIndices, uvIndices);
+    share(this->norms, norms);
+    share(this->nIndices, nIndices);
+    owners.emplace_back(posVec);
+    owners.emplace_back(idxVec);
+    triangleNum = this->indices.size() / 3;
+}
+
+kouek::MeshAssetImpl::MeshAssetImpl(StridedSpan<const glm::vec3> positions,
+                                    StridedSpan<const glm::vec3> colors,
+                                    StridedSpan<const glm::uint> indices,
+                                    StridedSpan<const glm::vec2> uvs,
+                                    StridedSpan<const glm::uint> uvIndices,
+                                    StridedSpan<const glm::vec3> norms,
+                                    StridedSpan<const glm::uint> nIndices,
+                                    std::shared_ptr<const void> owner)
+    : positions(positions), colors(colors), indices(indices), uvs(uvs),
+      uvIndices(uvIndices), norms(norms), nIndices(nIndices) {
+    if (owner)
+        owners.emplace_back(owner);
+    triangleNum = this->indices.size() / 3;
+}
+
+kouek::MeshAsset::AABB kouek::MeshAssetImpl::GetAABB() const {
+    if (pages)
+        return pagedAABB;
+    AABB aabb{glm::vec3{std::numeric_limits<float>::max()},
+              glm::vec3{std::numeric_limits<float>::lowest()}};
+    for (auto &pos : positions) {
+        aabb.min = glm::min(aabb.min, pos);
+        aabb.max = glm::max(aabb.max, pos);
+    }
+    // Quantized in the AABB of each run of them
+    if (compact)
+        for (auto &run : compact->runs) {
+            aabb.min = glm::min(aabb.min, run.min);
+            aabb.max = glm::max(aabb.max, run.min + run.step * 65535.f);
+        }
+    return aabb;
+}
+
+// Bytes of the elements of a view one after another
+template <typename T>
+static std::vector<uint8_t> packView(const kouek::StridedSpan<T> &view) {
+    std::vector<uint8_t> packed(sizeof(T) * view.size());
+    for (size_t i = 0; i < view.size(); ++i)
+        std::memcpy(packed.data() + sizeof(T) * i, &view[i], sizeof(T));
+    return packed;
+}
+
+bool kouek::MeshAssetImpl::Save(const std::string &path) const {
+    if (pages || compact)
+        return false;
+    GetOctree("");
+    std::lock_guard<std::mutex> lock(otreeMtx);
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.key = hashMesh();
+    auto otreeBytes = otree.Serialize(header.key);
+
+    std::array<const void *, SEC_NUM> dats;
+    // of strided arrays, packed as in the file
+    std::array<std::vector<uint8_t>, SEC_NUM> packeds;
+    // sharing the bytes of SEC_INDICES
+    std::array<bool, SEC_NUM> aliases{};
+    uint64_t offs = sizeof(FileHeader);
+    auto addSection = [&](FileSection sec, const void *dat, uint64_t elemSz,
+                          uint64_t num) {
+        offs = (offs + FILE_ALIGNMENT - 1) / FILE_ALIGNMENT * FILE_ALIGNMENT;
+        header.sections[sec] = {offs, elemSz, num};
+        dats[sec] = dat;
+        offs += elemSz * num;
+    };
+    auto addView = [&](FileSection sec, const auto &view) {
+        const void *dat = view.data();
+        if (!view.IsContiguous()) {
+            packeds[sec] = packView(view);
+            dat = packeds[sec].data();
+        }
+        addSection(sec, dat, sizeof(view[0]), view.size());
+    };
+    addView(SEC_POSITIONS, positions);
+    addView(SEC_COLORS, colors);
+    addView(SEC_INDICES, indices);
+    addView(SEC_UVS, uvs);
+    // Indices of welded vertices are stored once, and mapped as one
+    auto addIndices = [&](FileSection sec,
+                          const StridedSpan<const glm::uint> &view) {
+        aliases[sec] = !view.empty() && view.data() == indices.data() &&
+                       view.size() == indices.size() &&
+                       view.stride() == indices.stride();
+        if (aliases[sec])
+            header.sections[sec] = header.sections[SEC_INDICES];
+        else
+            addView(sec, view);
+    };
+    addIndices(SEC_UV_INDICES, uvIndices);
+    addView(SEC_NORMS, norms);
+    addIndices(SEC_N_INDICES, nIndices);
+    addSection(SEC_OCTREE, otreeBytes.data(), 1, otreeBytes.size());
+    auto addSpan = [&](FileSection sec, const auto &vec) {
+        addSection(sec, vec.data(), sizeof(vec[0]), vec.size());
+    };
+    addSpan(SEC_MESHLET_GROUPS, meshlets.GetGroups());
+    addSpan(SEC_MESHLETS, meshlets.GetMeshlets());
+    addSpan(SEC_MESHLET_VERTS, meshlets.GetVertices());
+    addSpan(SEC_MESHLET_FACES, meshlets.GetFaces());
+    addSpan(SEC_MESHLET_TRIS, meshlets.GetTriangles());
+
+    return WriteFileAside(path, [&](std::ostream &os) {
+        os.write((const char *)&header, sizeof(header));
+        uint64_t written = sizeof(header);
+        static constexpr std::array<char, FILE_ALIGNMENT> PADDING{};
+        for (uint8_t sec = 0; sec < SEC_NUM; ++sec) {
+            if (aliases[sec])
+                continue;
+            auto &section = header.sections[sec];
+            os.write(PADDING.data(), section.offs - written);
+            os.write((const char *)dats[sec], section.elemSz * section.num);
+            written = section.offs + section.elemSz * section.num;
+        }
+    });
+}
+
+std::shared_ptr<kouek::MeshAssetImpl>
+kouek::MeshAssetImpl::Load(const std::string &path, size_t pageBudget,
+                           const OnFacesLoaded &onFaces) {
+    auto file = MappedFile::Open(path);
+    if (!file || file->size() < sizeof(uint32_t))
+        return nullptr;
+    uint32_t magic;
+    std::memcpy(&magic, file->data(), sizeof(magic));
+    if (magic == COMP_FILE_MAGIC)
+        return loadCompressed(path, onFaces);
+    if (magic == PAGED_FILE_MAGIC)
+        return loadPaged(file, path, pageBudget);
+    if (file->size() < sizeof(FileHeader))
+        return nullptr;
+
+    FileHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION)
+        return nullptr;
+    for (uint8_t sec = 0; sec < SEC_NUM; ++sec) {
+        auto &section = header.sections[sec];
+        if (section.offs % FILE_ALIGNMENT != 0 ||
+            section.offs > file->size() || section.elemSz == 0 ||
+            section.num > (file->size() - section.offs) / section.elemSz)
+            return nullptr;
+    }
+
+    // Used in place, the asset keeps the mapping
+    bool valid = true;
+    auto toSpan = [&](FileSection sec, auto &span) {
+        using ElemTy = std::decay_t<decltype(span[0])>;
+        auto &section = header.sections[sec];
+        if (section.elemSz != sizeof(ElemTy))
+            valid = false;
+        else
+            span = {(const ElemTy *)(file->data() + section.offs),
+                    section.num};
+    };
+    StridedSpan<const glm::vec3> positions, colors, norms;
+    StridedSpan<const glm::vec2> uvs;
+    StridedSpan<const glm::uint> indices, uvIndices, nIndices;
+    toSpan(SEC_POSITIONS, positions);
+    toSpan(SEC_COLORS, colors);
+    toSpan(SEC_INDICES, indices);
+    toSpan(SEC_UVS, uvs);
+    toSpan(SEC_UV_INDICES, uvIndices);
+    toSpan(SEC_NORMS, norms);
+    toSpan(SEC_N_INDICES, nIndices);
+    if (!valid || indices.size() % 3 != 0)
+        return nullptr;
+    auto inRange = [](const auto &idxs, const auto &elems) {
+        auto num = (glm::uint)elems.size();
+        return std::all_of(idxs.begin(), idxs.end(),
+                           [&](glm::uint idx) { return idx < num; });
+    };
+    if (!inRange(indices, positions) || !inRange(uvIndices, uvs) ||
+        !inRange(nIndices, norms))
+        return nullptr;
+
+    auto asset = std::make_shared<MeshAssetImpl>(
+        positions, colors, indices, uvs, uvIndices, norms, nIndices, file);
+
+    // Built lazily instead if the prebuilt one does not fit
+    Span<const MeshletsTy::Group> groups;
+    Span<const MeshletsTy::Meshlet> mshlts;
+    Span<const glm::uint> mVerts, mFaces;
+    Span<const std::array<uint8_t, 3>> mTris;
+    toSpan(SEC_MESHLET_GROUPS, groups);
+    toSpan(SEC_MESHLETS, mshlts);
+    toSpan(SEC_MESHLET_VERTS, mVerts);
+    toSpan(SEC_MESHLET_FACES, mFaces);
+    toSpan(SEC_MESHLET_TRIS, mTris);
+    auto &otreeSec = header.sections[SEC_OCTREE];
+    if (valid && otreeSec.num != 0 &&
+        asset->otree.Load(file, otreeSec.offs, otreeSec.num, header.key) &&
+        groups.size() == asset->otree.GetNodes().size()) {
+        asset->meshlets.Assign(groups, mshlts, mVerts, mFaces, mTris);
+        asset->otreeBuilt = true;
+        ++asset->otreeVer;
+        asset->builtTriNum = asset->triangleNum;
+    }
+    return asset;
+}
+
+// Varints of the zigzagged differences from the previous value of the
+// same lane, entropy coded
+static std::vector<uint8_t> encodeInts(const glm::uint *vals, size_t num,
+                                       uint8_t laneNum) {
+    std::vector<uint8_t> raw;
+    raw.reserve(num * 2);
+    std::array<glm::uint, 3> prevs{0, 0, 0};
+    for (size_t i = 0; i < num; ++i) {
+        auto &prev = prevs[i % laneNum];
+        kouek::PutVarint(raw, kouek::ZigZag((int32_t)(vals[i] - prev)));
+        prev = vals[i];
+    }
+    return kouek::RANS::Encode(raw);
+}
+static bool decodeInts(const std::vector<uint8_t> &raw, glm::uint *vals,
+                       size_t num, uint8_t laneNum) {
+    std::array<glm::uint, 3> prevs{0, 0, 0};
+    auto itr = raw.data();
+    auto end = raw.data() + raw.size();
+    for (size_t i = 0; i < num; ++i) {
+        uint32_t v;
+        if (itr = kouek::GetVarint(itr, end, v); itr == nullptr)
+            return false;
+        auto &prev = prevs[i % laneNum];
+        prev += (glm::uint)kouek::UnZigZag(v);
+        vals[i] = prev;
+    }
+    return itr == end;
+}
+// Bytes of floats transposed into planes, so that the exponents and high
+// mantissa bytes, which vary little, are coded together
+static std::vector<uint8_t> encodeFloats(const float *vals, size_t num) {
+    std::vector<uint8_t> raw(num * sizeof(float));
+    auto bytes = (const uint8_t *)vals;
+    for (size_t i = 0; i < num; ++i)
+        for (uint8_t b = 0; b < sizeof(float); ++b)
+            raw[b * num + i] = bytes[i * sizeof(float) + b];
+    return kouek::RANS::Encode(raw);
+}
+static bool decodeFloats(const std::vector<uint8_t> &raw, float *vals,
+                         size_t num) {
+    if (raw.size() != num * sizeof(float))
+        return false;
+    auto bytes = (uint8_t *)vals;
+    for (size_t i = 0; i < num; ++i)
+        for (uint8_t b = 0; b < sizeof(float); ++b)
+            bytes[i * sizeof(float) + b] = raw[b * num + i];
+    return true;
+}
+
+// Elements indexed by idxs renumbered in the order faces in faceOrder
+// first use them, followed by those unused. Returns the old index of each.
+static std::vector<glm::uint>
+renumberByFirstUse(const std::vector<glm::uint> &faceOrder,
+                   kouek::StridedSpan<const glm::uint> idxs, size_t elemNum,
+                   std::vector<glm::uint> &newIdxs) {
+    static constexpr auto NONE = std::numeric_limits<glm::uint>::max();
+    std::vector<glm::uint> old2News(elemNum, NONE);
+    std::vector<glm::uint> new2Olds;
+    new2Olds.reserve(elemNum);
+    newIdxs.resize(idxs.size());
+    for (size_t i = 0; i < faceOrder.size(); ++i)
+        for (uint8_t t = 0; t < 3; ++t) {
+            auto old = idxs[faceOrder[i] * 3 + t];
+            if (old2News[old] == NONE) {
+                old2News[old] = (glm::uint)new2Olds.size();
+                new2Olds.emplace_back(old);
+            }
+            newIdxs[i * 3 + t] = old2News[old];
+        }
+    for (glm::uint old = 0; old < elemNum; ++old)
+        if (old2News[old] == NONE)
+            new2Olds.emplace_back(old);
+    return new2Olds;
+}
+
+bool kouek::MeshAssetImpl::SaveCompressed(const std::string &path,
+                                          uint32_t posBits) const {
+    if (pages || compact)
+        return false;
+    auto aabb = GetAABB();
+    GetOctree("");
+    std::lock_guard<std::mutex> lock(otreeMtx);
+
+    CompFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = COMP_FILE_MAGIC;
+    header.version = COMP_FILE_VERSION;
+    header.posBits = glm::clamp(posBits, 8u, 24u);
+    header.aabb.min = aabb.min;
+    header.aabb.max = aabb.max;
+
+    // Faces by leaf, cut into chunks at leaf ends, so that each chunk
+    // is spatially coherent
+    static constexpr size_t CHUNK_FACE_NUM = 1 << 14;
+    static constexpr size_t CHUNK_ELEM_NUM = 1 << 16;
+    std::vector<glm::uint> faceOrder;
+    std::vector<size_t> faceCuts{0};
+    faceOrder.reserve(triangleNum);
+    auto &leafIndices = otree.GetLeafIndices();
+    for (auto &node : otree.GetNodes()) {
+        if (!node.isLeaf)
+            continue;
+        faceOrder.insert(faceOrder.end(), leafIndices.begin() + node.first,
+                         leafIndices.begin() + node.first + node.dat);
+        if (faceOrder.size() - faceCuts.back() >= CHUNK_FACE_NUM)
+            faceCuts.emplace_back(faceOrder.size());
+    }
+    std::vector<bool> ordereds(triangleNum, false);
+    auto isPermutation = faceOrder.size() == triangleNum;
+    for (size_t i = 0; isPermutation && i < faceOrder.size(); ++i) {
+        isPermutation = faceOrder[i] < triangleNum && !ordereds[faceOrder[i]];
+        if (isPermutation)
+            ordereds[faceOrder[i]] = true;
+    }
+    if (!isPermutation) {
+        faceOrder.resize(triangleNum);
+        faceCuts.assign(1, 0);
+        for (glm::uint fIdx = 0; fIdx < triangleNum; ++fIdx) {
+            faceOrder[fIdx] = fIdx;
+            if (fIdx + 1 - faceCuts.back() >= CHUNK_FACE_NUM)
+                faceCuts.emplace_back(fIdx + 1);
+        }
+    }
+    if (faceCuts.back() != triangleNum)
+        faceCuts.emplace_back(triangleNum);
+
+    // Elements renumbered in the order faces first use them, which keeps
+    // index differences small
+    std::vector<glm::uint> newIdxs, newUVIdxs, newNIdxs;
+    std::vector<glm::uint> vNew2Olds, uvNew2Olds, nNew2Olds;
+    vNew2Olds =
+        renumberByFirstUse(faceOrder, indices, positions.size(), newIdxs);
+    if (!uvs.empty() && !uvIndices.empty())
+        uvNew2Olds = renumberByFirstUse(faceOrder, uvIndices, uvs.size(),
+                                        newUVIdxs);
+    if (!norms.empty() && !nIndices.empty())
+        nNew2Olds = renumberByFirstUse(faceOrder, nIndices, norms.size(),
+                                       newNIdxs);
+
+    auto maxQ = (float)((1u << header.posBits) - 1);
+    auto ext = aabb.max - aabb.min;
+    std::vector<glm::uint> qPoses(positions.size() * 3);
+    for (size_t v = 0; v < vNew2Olds.size(); ++v)
+        for (uint8_t xyz = 0; xyz < 3; ++xyz)
+            qPoses[v * 3 + xyz] =
+                ext[xyz] <= 0.f
+                    ? 0
+                    : (glm::uint)std::round(
+                          glm::clamp((positions[vNew2Olds[v]][xyz] -
+                                      aabb.min[xyz]) /
+                                         ext[xyz],
+                                     0.f, 1.f) *
+                          maxQ);
+    auto gather = [](const auto &elems,
+                     const std::vector<glm::uint> &new2Olds) {
+        std::vector<glm::vec3> ret;
+        ret.reserve(new2Olds.size());
+        for (auto old : new2Olds)
+            ret.emplace_back(elems[old]);
+        return ret;
+    };
+    auto newColors =
+        colors.size() == positions.size()
+            ? gather(colors, vNew2Olds)
+            : std::vector<glm::vec3>();
+    auto newNorms = gather(norms, nNew2Olds);
+    std::vector<glm::vec2> newUVs;
+    if (!uvNew2Olds.empty())
+        for (auto old : uvNew2Olds)
+            newUVs.emplace_back(uvs[old]);
+
+    // Each chunk of faces right after the chunks of the positions and
+    // colors it is the first to use, so that loading can hand faces out
+    // as they are decoded. Texture data follows all of them.
+    std::vector<CompChunk> chunks;
+    header.nums[SEC_POSITIONS] = positions.size();
+    header.nums[SEC_COLORS] = newColors.size();
+    header.nums[SEC_UVS] = newUVs.size();
+    header.nums[SEC_NORMS] = newNorms.size();
+    header.nums[SEC_INDICES] = newIdxs.size();
+    header.nums[SEC_UV_INDICES] = newUVIdxs.size();
+    header.nums[SEC_N_INDICES] = newNIdxs.size();
+    std::array<uint64_t, SEC_N_INDICES + 1> ends{};
+    auto addChunks = [&](FileSection sec, uint64_t end) {
+        end = std::min(end, header.nums[sec]);
+        while (ends[sec] < end) {
+            auto num = std::min<uint64_t>(CHUNK_ELEM_NUM,
+                                          header.nums[sec] - ends[sec]);
+            chunks.push_back({sec, ends[sec], num, 0});
+            ends[sec] += num;
+        }
+    };
+    auto addFaceChunks = [&](FileSection sec) {
+        for (size_t c = 1; c < faceCuts.size() && header.nums[sec] != 0; ++c)
+            chunks.push_back({sec, faceCuts[c - 1] * 3,
+                              (faceCuts[c] - faceCuts[c - 1]) * 3, 0});
+    };
+    uint64_t vertEnd = 0;
+    for (size_t c = 1; c < faceCuts.size(); ++c) {
+        for (auto i = faceCuts[c - 1] * 3; i < faceCuts[c] * 3; ++i)
+            vertEnd = std::max<uint64_t>(vertEnd, newIdxs[i] + 1);
+        addChunks(SEC_POSITIONS, vertEnd);
+        addChunks(SEC_COLORS, vertEnd);
+        chunks.push_back({SEC_INDICES, faceCuts[c - 1] * 3,
+                          (faceCuts[c] - faceCuts[c - 1]) * 3, 0});
+    }
+    for (auto sec : {SEC_POSITIONS, SEC_COLORS, SEC_UVS, SEC_NORMS})
+        addChunks(sec, header.nums[sec]);
+    addFaceChunks(SEC_UV_INDICES);
+    addFaceChunks(SEC_N_INDICES);
+    header.chunkNum = chunks.size();
+
+    std::vector<std::vector<uint8_t>> payloads(chunks.size());
+    ParallelFor(chunks.size(), [&](size_t beg, size_t end, uint32_t) {
+        for (auto cIdx = beg; cIdx < end; ++cIdx) {
+            auto &chunk = chunks[cIdx];
+            auto &payload = payloads[cIdx];
+            switch (chunk.sec) {
+            case SEC_POSITIONS:
+                payload = encodeInts(qPoses.data() + chunk.first * 3,
+                                     chunk.num * 3, 3);
+                break;
+            case SEC_COLORS:
+                payload = encodeFloats(&newColors[chunk.first].x,
+                                       chunk.num * 3);
+                break;
+            case SEC_UVS:
+                payload =
+                    encodeFloats(&newUVs[chunk.first].x, chunk.num * 2);
+                break;
+            case SEC_NORMS:
+                payload = encodeFloats(&newNorms[chunk.first].x,
+                                       chunk.num * 3);
+                break;
+            case SEC_INDICES:
+                payload = encodeInts(newIdxs.data() + chunk.first,
+                                     chunk.num, 1);
+                break;
+            case SEC_UV_INDICES:
+                payload = encodeInts(newUVIdxs.data() + chunk.first,
+                                     chunk.num, 1);
+                break;
+            case SEC_N_INDICES:
+                payload = encodeInts(newNIdxs.data() + chunk.first,
+                                     chunk.num, 1);
+                break;
+            }
+            chunk.byteNum = payload.size();
+        }
+    });
+
+    return WriteFileAside(path, [&](std::ostream &os) {
+        os.write((const char *)&header, sizeof(header));
+        os.write((const char *)chunks.data(),
+                 sizeof(CompChunk) * chunks.size());
+        for (auto &payload : payloads)
+            os.write((const char *)payload.data(), payload.size());
+    });
+}
+
+std::shared_ptr<kouek::MeshAssetImpl>
+kouek::MeshAssetImpl::loadCompressed(const std::string &path,
+                                     const OnFacesLoaded &onFaces) {
+    std::error_code ec;
+    auto fileSz = std::filesystem::file_size(path, ec);
+    std::ifstream is(path, std::ios::binary);
+    CompFileHeader header;
+    if (ec || !is.read((char *)&header, sizeof(header)) ||
+        header.magic != COMP_FILE_MAGIC ||
+        header.version != COMP_FILE_VERSION || header.posBits < 8 ||
+        header.posBits > 24 ||
+        header.chunkNum > fileSz / sizeof(CompChunk))
+        return nullptr;
+    auto &nums = header.nums;
+    auto pairs = [&](FileSection sec, FileSection base) {
+        return nums[sec] == 0 || nums[sec] == nums[base];
+    };
+    if (nums[SEC_INDICES] % 3 != 0 || !pairs(SEC_COLORS, SEC_POSITIONS) ||
+        !pairs(SEC_UV_INDICES, SEC_INDICES) ||
+        !pairs(SEC_N_INDICES, SEC_INDICES) ||
+        (nums[SEC_UV_INDICES] == 0) != (nums[SEC_UVS] == 0) ||
+        (nums[SEC_N_INDICES] == 0) != (nums[SEC_NORMS] == 0))
+        return nullptr;
+
+    // Chunks of each array follow each other and cover it
+    std::vector<CompChunk> chunks(header.chunkNum);
+    if (!is.read((char *)chunks.data(), sizeof(CompChunk) * chunks.size()))
+        return nullptr;
+    {
+        std::array<uint64_t, SEC_N_INDICES + 1> ends{};
+        for (auto &chunk : chunks) {
+            if (chunk.sec > SEC_N_INDICES || chunk.first != ends[chunk.sec] ||
+                chunk.num > nums[chunk.sec] - chunk.first ||
+                chunk.byteNum > fileSz ||
+                (chunk.sec == SEC_INDICES && chunk.num % 3 != 0))
+                return nullptr;
+            ends[chunk.sec] += chunk.num;
+        }
+        for (uint8_t sec = 0; sec <= SEC_N_INDICES; ++sec)
+            if (ends[sec] != nums[sec])
+                return nullptr;
+    }
+
+    try {
+        auto alloc = [&](FileSection sec, auto &vec) {
+            using VecTy = typename std::decay_t<decltype(*vec)>;
+            if (nums[sec] != 0 || sec == SEC_POSITIONS || sec == SEC_INDICES)
+                vec = std::make_shared<VecTy>(nums[sec]);
+        };
+        std::shared_ptr<std::vector<glm::vec3>> positions, colors, norms;
+        std::shared_ptr<std::vector<glm::vec2>> uvs;
+        std::shared_ptr<std::vector<glm::uint>> indices, uvIndices, nIndices;
+        alloc(SEC_POSITIONS, positions);
+        alloc(SEC_COLORS, colors);
+        alloc(SEC_INDICES, indices);
+        alloc(SEC_UVS, uvs);
+        alloc(SEC_UV_INDICES, uvIndices);
+        alloc(SEC_NORMS, norms);
+        alloc(SEC_N_INDICES, nIndices);
+
+        auto &aabb = header.aabb;
+        auto scale =
+            (aabb.max - aabb.min) / (float)((1u << header.posBits) - 1);
+        auto decodeChunk = [&](const CompChunk &chunk,
+                               const std::vector<uint8_t> &bytes) {
+            std::vector<uint8_t> raw;
+            if (!RANS::Decode(bytes.data(), bytes.data() + bytes.size(), raw,
+                              chunk.num * 3 * 5))
+                return false;
+            auto decodeIdxs = [&](glm::uint *idxs, uint64_t elemNum) {
+                if (!decodeInts(raw, idxs + chunk.first, chunk.num, 1))
+                    return false;
+                return std::all_of(
+                    idxs + chunk.first, idxs + chunk.first + chunk.num,
+                    [&](glm::uint idx) { return idx < elemNum; });
+            };
+            switch (chunk.sec) {
+            case SEC_POSITIONS: {
+                std::vector<glm::uint> qPoses(chunk.num * 3);
+                if (!decodeInts(raw, qPoses.data(), qPoses.size(), 3))
+                    return false;
+                for (size_t v = 0; v < chunk.num; ++v)
+                    (*positions)[chunk.first + v] =
+                        aabb.min + scale * glm::vec3{qPoses[v * 3 + 0],
+                                                     qPoses[v * 3 + 1],
+                                                     qPoses[v * 3 + 2]};
+                return true;
+            }
+            case SEC_COLORS:
+                return decodeFloats(raw, &(*colors)[chunk.first].x,
+                                    chunk.num * 3);
+            case SEC_UVS:
+                return decodeFloats(raw, &(*uvs)[chunk.first].x,
+                                    chunk.num * 2);
+            case SEC_NORMS:
+                return decodeFloats(raw, &(*norms)[chunk.first].x,
+                                    chunk.num * 3);
+            case SEC_INDICES:
+                return decodeIdxs(indices->data(), nums[SEC_POSITIONS]);
+            case SEC_UV_INDICES:
+                return decodeIdxs(uvIndices->data(), nums[SEC_UVS]);
+            case SEC_N_INDICES:
+                return decodeIdxs(nIndices->data(), nums[SEC_NORMS]);
+            }
+            return false;
+        };
+
+        // Read chunks in order while workers decode those read, with a
+        // bounded number of them in flight. Faces are handed out once all
+        // chunks up to theirs are decoded.
+        struct Task {
+            size_t chunkIdx;
+            std::vector<uint8_t> bytes;
+        };
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::queue<Task> tasks;
+        bool readDone = false;
+        std::atomic<bool> valid = true;
+        std::vector<bool> decodeds(chunks.size(), false);
+        size_t decodedEnd = 0;
+        auto workerNum = GetThreadNum();
+        std::vector<std::thread> workers;
+        for (uint32_t w = 0; w < workerNum; ++w)
+            workers.emplace_back([&]() {
+                while (true) {
+                    Task task;
+                    {
+                        std::unique_lock<std::mutex> lk(mtx);
+                        cv.wait(lk,
+                                [&]() { return !tasks.empty() || readDone; });
+                        if (tasks.empty())
+                            return;
+                        task = std::move(tasks.front());
+                        tasks.pop();
+                    }
+                    cv.notify_all();
+                    if (valid &&
+                        !decodeChunk(chunks[task.chunkIdx], task.bytes))
+                        valid = false;
+                    if (!valid || !onFaces)
+                        continue;
+
+                    std::vector<size_t> readies;
+                    {
+                        std::lock_guard<std::mutex> lk(mtx);
+                        decodeds[task.chunkIdx] = true;
+                        for (; decodedEnd < chunks.size() &&
+                               decodeds[decodedEnd];
+                             ++decodedEnd)
+                            if (chunks[decodedEnd].sec == SEC_INDICES)
+                                readies.emplace_back(decodedEnd);
+                    }
+                    static const std::vector<glm::vec3> NO_COLORS;
+                    for (auto cIdx : readies)
+                        if (valid && !onFaces(*positions,
+                                              colors ? *colors : NO_COLORS,
+                                              *indices, chunks[cIdx].first / 3,
+                                              chunks[cIdx].num / 3))
+                            valid = false;
+                }
+            });
+        for (size_t cIdx = 0; cIdx < chunks.size() && valid; ++cIdx) {
+            std::vector<uint8_t> bytes(chunks[cIdx].byteNum);
+            if (!is.read((char *)bytes.data(), bytes.size())) {
+                valid = false;
+                break;
+            }
+            {
+                std::unique_lock<std::mutex> lk(mtx);
+                cv.wait(lk, [&]() { return tasks.size() < 2 * workerNum; });
+                tasks.push({cIdx, std::move(bytes)});
+            }
+            cv.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            readDone = true;
+        }
+        cv.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+        if (!valid)
+            return nullptr;
+
+        return std::make_shared<MeshAssetImpl>(
+            positions, colors, indices, uvs, uvIndices, norms, nIndices);
+    } catch (std::exception &) {
+        return nullptr;
+    }
+}
+
+bool kouek::MeshAssetImpl::SavePaged(const std::string &path) const {
+    if (pages || compact)
+        return false;
+    auto aabb = GetAABB();
+    GetOctree("");
+    std::lock_guard<std::mutex> lock(otreeMtx);
+
+    PagedFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = PAGED_FILE_MAGIC;
+    header.version = PAGED_FILE_VERSION;
+    header.key = hashMesh();
+    header.triangleNum = triangleNum;
+    header.aabb.min = aabb.min;
+    header.aabb.max = aabb.max;
+    auto otreeBytes = otree.Serialize(header.key, false);
+    auto &nodes = otree.GetNodes();
+    auto align = [](uint64_t offs) {
+        return (offs + FILE_ALIGNMENT - 1) / FILE_ALIGNMENT * FILE_ALIGNMENT;
+    };
+    header.otreeOffs = align(sizeof(header));
+    header.otreeSz = otreeBytes.size();
+    header.pageTableOffs = align(header.otreeOffs + header.otreeSz);
+    header.nodeNum = nodes.size();
+
+    // A leaf's faces in the order of its meshlets, as an unpaged leaf is
+    // drawn, and its elements renumbered in the order they are used
+    auto hasColors = colors.size() == positions.size();
+    auto &mGroups = meshlets.GetGroups();
+    auto &mMeshlets = meshlets.GetMeshlets();
+    auto &mFaces = meshlets.GetFaces();
+    auto genPage = [&](glm::uint nodeIdx) {
+        std::vector<glm::uint> faces;
+        auto &group = mGroups[nodeIdx];
+        for (auto b = group.first; b < group.first + group.num; ++b)
+            faces.insert(faces.end(),
+                         mFaces.begin() + mMeshlets[b].triFirst,
+                         mFaces.begin() + mMeshlets[b].triFirst +
+                             mMeshlets[b].triNum);
+
+        LeafPage page;
+        auto localize = [&](const StridedSpan<const glm::uint> &idxs,
+                            std::vector<glm::uint> &localIdxs,
+                            std::vector<glm::uint> &locals) {
+            std::unordered_map<glm::uint, glm::uint> old2News;
+            for (auto f : faces)
+                for (uint8_t t = 0; t < 3; ++t) {
+                    auto old = idxs[f * 3 + t];
+                    auto [itr, inserted] =
+                        old2News.emplace(old, (glm::uint)locals.size());
+                    if (inserted)
+                        locals.emplace_back(old);
+                    localIdxs.emplace_back(itr->second);
+                }
+        };
+        std::vector<glm::uint> vLocals, uvLocals, nLocals;
+        localize(indices, page.indices, vLocals);
+        for (auto old : vLocals) {
+            page.positions.emplace_back(positions[old]);
+            if (hasColors)
+                page.colors.emplace_back(colors[old]);
+        }
+        if (!uvs.empty() && !uvIndices.empty()) {
+            localize(uvIndices, page.uvIndices, uvLocals);
+            for (auto old : uvLocals)
+                page.uvs.emplace_back(uvs[old]);
+        }
+        if (!norms.empty() && !nIndices.empty()) {
+            localize(nIndices, page.nIndices, nLocals);
+            for (auto old : nLocals)
+                page.norms.emplace_back(norms[old]);
+        }
+
+        PageHeader pageHeader;
+        std::vector<uint8_t> bytes(sizeof(pageHeader));
+        auto addArray = [&](FileSection sec, const auto &vec) {
+            pageHeader.nums[sec] = (uint32_t)vec.size();
+            auto dat = (const uint8_t *)vec.data();
+            bytes.insert(bytes.end(), dat, dat + sizeof(vec[0]) * vec.size());
+        };
+        addArray(SEC_POSITIONS, page.positions);
+        addArray(SEC_COLORS, page.colors);
+        addArray(SEC_INDICES, page.indices);
+        addArray(SEC_UVS, page.uvs);
+        addArray(SEC_UV_INDICES, page.uvIndices);
+        addArray(SEC_NORMS, page.norms);
+        addArray(SEC_N_INDICES, page.nIndices);
+        std::memcpy(bytes.data(), &pageHeader, sizeof(pageHeader));
+        return bytes;
+    };
+
+    // Pages are written as generated, then the table of their ranges
+    return WriteFileAside(path, [&](std::ostream &os) {
+        static constexpr std::array<char, FILE_ALIGNMENT> PADDING{};
+        std::vector<PageRange> ranges(nodes.size(), PageRange{0, 0});
+        uint64_t written = 0;
+        auto writeAt = [&](uint64_t offs, const void *dat, uint64_t sz) {
+            os.write(PADDING.data(), offs - written);
+            os.write((const char *)dat, sz);
+            written = offs + sz;
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.otreeOffs, otreeBytes.data(), otreeBytes.size());
+        writeAt(header.pageTableOffs, ranges.data(),
+                sizeof(PageRange) * ranges.size());
+        for (glm::uint nodeIdx = 0; nodeIdx < nodes.size() && os.good();
+             ++nodeIdx) {
+            if (!nodes[nodeIdx].isLeaf || nodes[nodeIdx].dat == 0)
+                continue;
+            auto bytes = genPage(nodeIdx);
+            ranges[nodeIdx] = {align(written), bytes.size()};
+            writeAt(ranges[nodeIdx].offs, bytes.data(), bytes.size());
+        }
+        os.seekp(header.pageTableOffs);
+        os.write((const char *)ranges.data(),
+                 sizeof(PageRange) * ranges.size());
+    });
+}
+
+std::shared_ptr<kouek::MeshAssetImpl>
+kouek::MeshAssetImpl::loadPaged(std::shared_ptr<MappedFile> file,
+                                const std::string &path,
+                                size_t pageBudget) {
+    PagedFileHeader header;
+    if (file->size() < sizeof(header))
+        return nullptr;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != PAGED_FILE_MAGIC ||
+        header.version != PAGED_FILE_VERSION ||
+        header.pageTableOffs > file->size() ||
+        header.nodeNum >
+            (file->size() - header.pageTableOffs) / sizeof(PageRange))
+        return nullptr;
+
+    // Only the octree and the page ranges stay in memory
+    auto asset = std::make_shared<MeshAssetImpl>(
+        StridedSpan<const glm::vec3>(), StridedSpan<const glm::vec3>(),
+        StridedSpan<const glm::uint>(), StridedSpan<const glm::vec2>(),
+        StridedSpan<const glm::uint>(), StridedSpan<const glm::vec3>(),
+        StridedSpan<const glm::uint>(), nullptr);
+    if (!asset->otree.Load(file, header.otreeOffs, header.otreeSz,
+                           header.key) ||
+        asset->otree.GetNodeNum() != header.nodeNum)
+        return nullptr;
+    auto &ranges = asset->pageRanges;
+    ranges.resize(header.nodeNum);
+    std::memcpy(ranges.data(), file->data() + header.pageTableOffs,
+                sizeof(PageRange) * ranges.size());
+    for (auto &range : ranges)
+        if (range.offs > file->size() ||
+            range.byteNum > file->size() - range.offs)
+            return nullptr;
+
+    asset->triangleNum = header.triangleNum;
+    asset->pagedAABB = {header.aabb.min, header.aabb.max};
+    asset->otreeBuilt = true;
+    ++asset->otreeVer;
+    asset->builtTriNum = asset->triangleNum;
+    asset->pagedPath = path;
+    asset->pages = std::make_unique<PageCache<glm::uint, LeafPage>>(
+        pageBudget, [ptr = asset.get()](glm::uint nodeIdx) {
+            return ptr->readLeafPage(nodeIdx);
+        });
+    return asset;
+}
+
+std::shared_ptr<const kouek::MeshAssetImpl::LeafPage>
+kouek::MeshAssetImpl::readLeafPage(glm::uint nodeIdx) const {
+    if (nodeIdx >= pageRanges.size() || pageRanges[nodeIdx].byteNum == 0)
+        return nullptr;
+
+    // A stream is used by a single read at a time
+    std::unique_ptr<std::ifstream> is;
+    {
+        std::lock_guard<std::mutex> lk(streamMtx);
+        if (!streams.empty()) {
+            is = std::move(streams.back());
+            streams.pop_back();
+        }
+    }
+    if (!is)
+        is = std::make_unique<std::ifstream>(pagedPath, std::ios::binary);
+    auto &range = pageRanges[nodeIdx];
+    std::vector<uint8_t> bytes(range.byteNum);
+    if (!is->seekg(range.offs) ||
+        !is->read((char *)bytes.data(), bytes.size()))
+        return nullptr;
+    {
+        std::lock_guard<std::mutex> lk(streamMtx);
+        streams.emplace_back(std::move(is));
+    }
+
+    PageHeader header;
+    if (bytes.size() < sizeof(header))
+        return nullptr;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    auto page = std::make_shared<LeafPage>();
+    uint64_t offs = sizeof(header);
+    auto getArray = [&](FileSection sec, auto &vec) {
+        using ElemTy = typename std::decay_t<decltype(vec)>::value_type;
+        auto sz = sizeof(ElemTy) * (uint64_t)header.nums[sec];
+        if (sz > bytes.size() - offs)
+            return false;
+        vec.resize(header.nums[sec]);
+        std::memcpy(vec.data(), bytes.data() + offs, sz);
+        offs += sz;
+        return true;
+    };
+    auto inRange = [](const auto &idxs, const auto &elems) {
+        return std::all_of(idxs.begin(), idxs.end(), [&](glm::uint idx) {
+            return idx < elems.size();
+        });
+    };
+    auto pairs = [](const auto &vec, const auto &base) {
+        return vec.empty() || vec.size() == base.size();
+    };
+    if (!getArray(SEC_POSITIONS, page->positions) ||
+        !getArray(SEC_COLORS, page->colors) ||
+        !getArray(SEC_INDICES, page->indices) ||
+        !getArray(SEC_UVS, page->uvs) ||
+        !getArray(SEC_UV_INDICES, page->uvIndices) ||
+        !getArray(SEC_NORMS, page->norms) ||
+        !getArray(SEC_N_INDICES, page->nIndices) ||
+        page->indices.size() % 3 != 0 ||
+        !pairs(page->colors, page->positions) ||
+        !pairs(page->uvIndices, page->indices) ||
+        !pairs(page->nIndices, page->indices) ||
+        page->uvIndices.empty() != page->uvs.empty() ||
+        page->nIndices.empty() != page->norms.empty() ||
+        !inRange(page->indices, page->positions) ||
+        !inRange(page->uvIndices, page->uvs) ||
+        !inRange(page->nIndices, page->norms))
+        return nullptr;
+    return page;
+}
+
+const kouek::MeshAssetImpl::OctreeTy &
+kouek::MeshAssetImpl::GetOctree(const std::string &cacheDir) const {
+    std::lock_guard<std::mutex> lock(otreeMtx);
+    if (!otreeBuilt) {
+        buildOctree(cacheDir);
+        buildMeshlets();
+        lodsBuilt = false;
+    }
+    return otree;
+}
+
+const kouek::MeshAssetImpl::LODs &kouek::MeshAssetImpl::GetLODs() const {
+    std::lock_guard<std::mutex> lock(otreeMtx);
+    buildLODs();
+    return lods;
+}
+
+std::shared_ptr<kouek::MeshAssetImpl> kouek::MeshAssetImpl::Clone() const {
+    auto copy = [](const auto &view) {
+        using ElemTy = std::decay_t<decltype(view[0])>;
+        return view.empty() ? nullptr
+                            : std::make_shared<std::vector<ElemTy>>(
+                                  view.begin(), view.end());
+    };
+    auto ret = std::make_shared<MeshAssetImpl>(
+        copy(positions), copy(colors), copy(indices), copy(uvs),
+        copy(uvIndices), copy(norms), copy(nIndices));
+    ret->vecsOwned = true;
+    return ret;
+}
+
+std::shared_ptr<const kouek::MeshAsset> kouek::MeshAssetImpl::Weld() const {
+    if (pages || compact)
+        return nullptr;
+    auto hasColors = colors.size() == positions.size();
+    auto hasUVs = !uvs.empty() && uvIndices.size() == indices.size();
+    auto hasNorms = !norms.empty() && nIndices.size() == indices.size();
+
+    // Welded vertices of a position are chained from it, as only a few
+    // corners on seams differ in uv or normal
+    static constexpr auto NONE = std::numeric_limits<glm::uint>::max();
+    struct Welded {
+        glm::uint pos, uv, n;
+        glm::uint next;
+    };
+    std::vector<glm::uint> heads(positions.size(), NONE);
+    std::vector<Welded> welds;
+    auto weldIdxs = std::make_shared<std::vector<glm::uint>>(indices.size());
+    for (size_t c = 0; c < indices.size(); ++c) {
+        Welded w{indices[c], hasUVs ? uvIndices[c] : 0,
+                 hasNorms ? nIndices[c] : 0, heads[indices[c]]};
+        auto idx = w.next;
+        while (idx != NONE && (welds[idx].uv != w.uv || welds[idx].n != w.n))
+            idx = welds[idx].next;
+        if (idx == NONE) {
+            idx = (glm::uint)welds.size();
+            heads[w.pos] = idx;
+            welds.emplace_back(w);
+        }
+        (*weldIdxs)[c] = idx;
+    }
+
+    // Position, color, normal and uv of a vertex side by side, as floats
+    auto fltNum = 3 + (hasColors ? 3 : 0) + (hasNorms ? 3 : 0) +
+                  (hasUVs ? 2 : 0);
+    // Corners of faceted models share few normals, each would take a
+    // vertex of its own
+    auto idxByteNum = sizeof(glm::uint) * indices.size();
+    auto byteNum = sizeof(glm::vec3) * positions.size() * (hasColors ? 2 : 1) +
+                   idxByteNum;
+    if (hasUVs)
+        byteNum += sizeof(glm::vec2) * uvs.size() + idxByteNum;
+    if (hasNorms)
+        byteNum += sizeof(glm::vec3) * norms.size() + idxByteNum;
+    if (sizeof(float) * fltNum * welds.size() + idxByteNum > byteNum)
+        return nullptr;
+    auto verts = std::make_shared<std::vector<float>>(fltNum * welds.size());
+    for (size_t i = 0; i < welds.size(); ++i) {
+        auto *dst = verts->data() + fltNum * i;
+        auto put = [&](const auto &attr) {
+            std::memcpy(dst, &attr, sizeof(attr));
+            dst += sizeof(attr) / sizeof(float);
+        };
+        put(positions[welds[i].pos]);
+        if (hasColors)
+            put(colors[welds[i].pos]);
+        if (hasNorms)
+            put(norms[welds[i].n]);
+        if (hasUVs)
+            put(uvs[welds[i].uv]);
+    }
+    size_t offs = 0;
+    auto view = [&](auto &span, bool has) {
+        using ElemTy = std::decay_t<decltype(span[0])>;
+        if (!has)
+            return;
+        span = {(const ElemTy *)(verts->data() + offs), welds.size(),
+                sizeof(float) * fltNum};
+        offs += sizeof(ElemTy) / sizeof(float);
+    };
+    StridedSpan<const glm::vec3> wPositions, wColors, wNorms;
+    StridedSpan<const glm::vec2> wUVs;
+    view(wPositions, true);
+    view(wColors, hasColors);
+    view(wNorms, hasNorms);
+    view(wUVs, hasUVs);
+    StridedSpan<const glm::uint> wIndices(*weldIdxs);
+    return std::make_shared<MeshAssetImpl>(
+        wPositions, wColors, wIndices, wUVs,
+        hasUVs ? wIndices : StridedSpan<const glm::uint>(), wNorms,
+        hasNorms ? wIndices : StridedSpan<const glm::uint>(),
+        std::make_shared<std::tuple<decltype(verts), decltype(weldIdxs)>>(
+            verts, weldIdxs));
+}
+
+std::shared_ptr<const kouek::MeshAsset> kouek::MeshAssetImpl::Reorder() const {
+    if (pages || compact)
+        return nullptr;
+    auto aabb = GetAABB();
+    GetOctree("");
+    std::lock_guard<std::mutex> lock(otreeMtx);
+
+    // Leaves in the order of their ranges in leafIndices, their faces
+    // taking ranges of the copy one after another
+    auto &nodes = otree.GetNodes();
+    std::vector<glm::uint> leaves;
+    for (glm::uint nodeIdx = 0; nodeIdx < nodes.size(); ++nodeIdx)
+        if (nodes[nodeIdx].isLeaf && nodes[nodeIdx].dat != 0)
+            leaves.emplace_back(nodeIdx);
+    std::sort(leaves.begin(), leaves.end(), [&](glm::uint a, glm::uint b) {
+        return nodes[a].first < nodes[b].first;
+    });
+
+    // In a leaf, meshlets facing away from the center of the model come
+    // first, as they are likely to occlude the others from any view, and
+    // faces in a meshlet are ordered for a vertex cache
+    auto &mGroups = meshlets.GetGroups();
+    auto &mMeshlets = meshlets.GetMeshlets();
+    auto &mVerts = meshlets.GetVertices();
+    auto &mFaces = meshlets.GetFaces();
+    auto &mTris = meshlets.GetTriangles();
+    auto ctr = .5f * (aabb.min + aabb.max);
+    std::vector<glm::uint> faceOrder(triangleNum);
+    // meshlets and triangles of the source in their order in the copy
+    std::vector<glm::uint> triSrcs(triangleNum);
+    std::vector<glm::uint> leafOffs(leaves.size() + 1, 0);
+    std::vector<glm::uint> leafMOffs(leaves.size() + 1, 0);
+    for (size_t l = 0; l < leaves.size(); ++l) {
+        auto &group = mGroups[leaves[l]];
+        leafOffs[l + 1] = leafOffs[l];
+        for (auto b = group.first; b < group.first + group.num; ++b)
+            leafOffs[l + 1] += mMeshlets[b].triNum;
+        leafMOffs[l + 1] = leafMOffs[l] + group.num;
+    }
+    if (leafOffs.back() != triangleNum)
+        return nullptr;
+    std::vector<glm::uint> mSrcs(leafMOffs.back());
+    ParallelFor(leaves.size(), [&](size_t beg, size_t end, uint32_t) {
+        std::vector<std::tuple<float, glm::uint>> sorteds;
+        for (auto l = beg; l < end; ++l) {
+            auto &group = mGroups[leaves[l]];
+            sorteds.clear();
+            for (auto b = group.first; b < group.first + group.num; ++b) {
+                auto &m = mMeshlets[b];
+                sorteds.emplace_back(-glm::dot(m.ctr - ctr, m.coneAxis), b);
+            }
+            std::sort(sorteds.begin(), sorteds.end());
+
+            auto offs = leafOffs[l];
+            auto mOffs = leafMOffs[l];
+            for (auto [key, b] : sorteds) {
+                auto &m = mMeshlets[b];
+                mSrcs[mOffs++] = b;
+                for (auto t : OptimizeVertexCache(
+                         Span<const std::array<uint8_t, 3>>(
+                             mTris.data() + m.triFirst, m.triNum),
+                         m.vertNum)) {
+                    triSrcs[offs] = m.triFirst + t;
+                    faceOrder[offs++] = mFaces[m.triFirst + t];
+                }
+            }
+        }
+    });
+
+    // Elements renumbered in the order faces first use them, texture
+    // data of welded vertices along with positions
+    auto gather = [](const auto &elems,
+                     const std::vector<glm::uint> &new2Olds) {
+        using ElemTy = std::decay_t<decltype(elems[0])>;
+        auto ret = std::make_shared<std::vector<ElemTy>>();
+        ret->reserve(new2Olds.size());
+        for (auto old : new2Olds)
+            ret->emplace_back(elems[old]);
+        return ret;
+    };
+    auto newIdxs = std::make_shared<std::vector<glm::uint>>();
+    auto vNew2Olds =
+        renumberByFirstUse(faceOrder, indices, positions.size(), *newIdxs);
+    auto newPositions = gather(positions, vNew2Olds);
+    auto newColors = colors.size() == positions.size()
+                         ? gather(colors, vNew2Olds)
+                         : nullptr;
+    std::shared_ptr<std::vector<glm::vec2>> newUVs;
+    std::shared_ptr<std::vector<glm::uint>> newUVIdxs;
+    if (uvIndices.data() == indices.data() && !uvs.empty()) {
+        newUVs = gather(uvs, vNew2Olds);
+        newUVIdxs = newIdxs;
+    } else if (!uvs.empty() && !uvIndices.empty()) {
+        newUVIdxs = std::make_shared<std::vector<glm::uint>>();
+        newUVs = gather(uvs, renumberByFirstUse(faceOrder, uvIndices,
+                                                uvs.size(), *newUVIdxs));
+    }
+    std::shared_ptr<std::vector<glm::vec3>> newNorms;
+    std::shared_ptr<std::vector<glm::uint>> newNIdxs;
+    if (nIndices.data() == indices.data() && !norms.empty()) {
+        newNorms = gather(norms, vNew2Olds);
+        newNIdxs = newIdxs;
+    } else if (!norms.empty() && !nIndices.empty()) {
+        newNIdxs = std::make_shared<std::vector<glm::uint>>();
+        newNorms = gather(norms, renumberByFirstUse(faceOrder, nIndices,
+                                                    norms.size(), *newNIdxs));
+    }
+    auto ret = std::make_shared<MeshAssetImpl>(newPositions, newColors,
+                                               newIdxs, newUVs, newUVIdxs,
+                                               newNorms, newNIdxs);
+
+    // The octree and meshlets are handed over renumbered, as faces keep
+    // their leaves and meshlets, now laid out in their order
+    std::vector<glm::uint> seqs(triangleNum);
+    for (glm::uint i = 0; i < triangleNum; ++i)
+        seqs[i] = i;
+    std::vector<OctreeTy::LinearNode> newNodes(nodes.begin(), nodes.end());
+    for (auto &node : newNodes)
+        if (node.isLeaf && node.dat == 0)
+            node.first = 0;
+    std::vector<MeshletsTy::Group> newGroups(mGroups.size(),
+                                             MeshletsTy::Group{0, 0});
+    for (size_t l = 0; l < leaves.size(); ++l) {
+        newNodes[leaves[l]].first = leafOffs[l];
+        newGroups[leaves[l]] = {leafMOffs[l], mGroups[leaves[l]].num};
+    }
+
+    std::vector<glm::uint> vOld2News(vNew2Olds.size());
+    for (glm::uint v = 0; v < vNew2Olds.size(); ++v)
+        vOld2News[vNew2Olds[v]] = v;
+    std::vector<MeshletsTy::Meshlet> newMeshlets(mSrcs.size());
+    std::vector<glm::uint> newVerts;
+    glm::uint triFirst = 0;
+    for (size_t i = 0; i < mSrcs.size(); ++i) {
+        auto &m = newMeshlets[i];
+        m = mMeshlets[mSrcs[i]];
+        auto vertFirst = m.vertFirst;
+        m.vertFirst = (glm::uint)newVerts.size();
+        for (auto v = vertFirst; v < vertFirst + m.vertNum; ++v)
+            newVerts.emplace_back(vOld2News[mVerts[v]]);
+        m.triFirst = triFirst;
+        triFirst += m.triNum;
+    }
+    std::vector<std::array<uint8_t, 3>> newTris(triangleNum);
+    for (glm::uint i = 0; i < triangleNum; ++i)
+        newTris[i] = mTris[triSrcs[i]];
+
+    ret->otree.Assign(newNodes, otree.GetChildBounds(), seqs);
+    ret->meshlets.Assign(newGroups, newMeshlets, newVerts, seqs, newTris);
+    ret->otreeBuilt = true;
+    ++ret->otreeVer;
+    ret->builtTriNum = ret->triangleNum;
+    return ret;
+}
+
+// n onto the octahedron |x| + |y| + |z| = 1, its lower half folded out
+// over the corners, in [0, 65535]^2
+static glm::u16vec2 encodeOctahedral(const glm::vec3 &n) {
+    auto l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if (!(l1 > 0.f))
+        return glm::u16vec2{32768};
+    glm::vec2 e{n.x / l1, n.y / l1};
+    if (n.z < 0.f)
+        e = glm::vec2{(1.f - fabsf(e.y)) * (e.x >= 0.f ? 1.f : -1.f),
+                      (1.f - fabsf(e.x)) * (e.y >= 0.f ? 1.f : -1.f)};
+    return glm::u16vec2(
+        glm::round(glm::clamp(e * .5f + .5f, 0.f, 1.f) * 65535.f));
+}
+
+std::shared_ptr<const kouek::MeshAsset> kouek::MeshAssetImpl::Compact() const {
+    if (pages || compact)
+        return nullptr;
+    auto packed = std::make_shared<CompactVerts>();
+    auto quantize = [](float x, float min, float step) {
+        return step > 0.f ? (uint16_t)std::clamp(roundf((x - min) / step),
+                                                 0.f, 65535.f)
+                          : (uint16_t)0;
+    };
+
+    static constexpr auto RUN_VERT_NUM = CompactVerts::RUN_VERT_NUM;
+    auto vertNum = positions.size();
+    packed->runs.resize((vertNum + RUN_VERT_NUM - 1) / RUN_VERT_NUM);
+    packed->positions.resize(vertNum);
+    ParallelFor(packed->runs.size(), [&](size_t beg, size_t end, uint32_t) {
+        for (auto r = beg; r < end; ++r) {
+            auto first = r * RUN_VERT_NUM;
+            auto last = std::min(first + RUN_VERT_NUM, vertNum);
+            glm::vec3 min{std::numeric_limits<float>::max()};
+            glm::vec3 max{std::numeric_limits<float>::lowest()};
+            for (auto v = first; v < last; ++v) {
+                min = glm::min(min, positions[v]);
+                max = glm::max(max, positions[v]);
+            }
+            auto &run = packed->runs[r];
+            run.min = min;
+            run.step = (max - min) / 65535.f;
+            for (auto v = first; v < last; ++v)
+                for (uint8_t xyz = 0; xyz < 3; ++xyz)
+                    packed->positions[v][xyz] = quantize(
+                        positions[v][xyz], run.min[xyz], run.step[xyz]);
+        }
+    });
+
+    if (!uvs.empty()) {
+        glm::vec2 min{std::numeric_limits<float>::max()};
+        glm::vec2 max{std::numeric_limits<float>::lowest()};
+        for (auto &uv : uvs) {
+            min = glm::min(min, uv);
+            max = glm::max(max, uv);
+        }
+        packed->uvMin = min;
+        packed->uvStep = (max - min) / 65535.f;
+        packed->uvs.resize(uvs.size());
+        for (size_t i = 0; i < uvs.size(); ++i)
+            for (uint8_t xy = 0; xy < 2; ++xy)
+                packed->uvs[i][xy] =
+                    quantize(uvs[i][xy], min[xy], packed->uvStep[xy]);
+    }
+
+    // Normals Mesh generates for faces are computed again when drawn
+    auto areFaceNorms = [&]() {
+        if (norms.size() != triangleNum || nIndices.size() != indices.size() ||
+            nIndices.data() == indices.data())
+            return false;
+        for (glm::uint fIdx = 0; fIdx < triangleNum; ++fIdx) {
+            auto idxIdx = fIdx * 3;
+            if (nIndices[idxIdx + 0] != fIdx || nIndices[idxIdx + 1] != fIdx ||
+                nIndices[idxIdx + 2] != fIdx)
+                return false;
+            auto &p0 = positions[indices[idxIdx + 0]];
+            auto n = glm::cross(positions[indices[idxIdx + 1]] - p0,
+                                positions[indices[idxIdx + 2]] - p0);
+            if (glm::distance(n, norms[fIdx]) > 1e-4f * glm::length(n))
+                return false;
+        }
+        return true;
+    };
+    if (areFaceNorms())
+        packed->faceNorms = true;
+    else if (!norms.empty()) {
+        packed->norms.resize(norms.size());
+        ParallelFor(norms.size(), [&](size_t beg, size_t end, uint32_t) {
+            for (auto i = beg; i < end; ++i)
+                packed->norms[i] = encodeOctahedral(norms[i]);
+        });
+    }
+
+    auto copy = [](const auto &view) {
+        using ElemTy = std::decay_t<decltype(view[0])>;
+        return view.empty() ? nullptr
+                            : std::make_shared<std::vector<ElemTy>>(
+                                  view.begin(), view.end());
+    };
+    auto newIdxs = copy(indices);
+    // Aliasing indices as welded ones do
+    auto copyIdxs = [&](const StridedSpan<const glm::uint> &idxs) {
+        return idxs.data() == indices.data() ? newIdxs : copy(idxs);
+    };
+    auto newUVIdxs = uvs.empty() ? nullptr : copyIdxs(uvIndices);
+    auto newNIdxs = packed->norms.empty() ? nullptr : copyIdxs(nIndices);
+
+    // The spatial index is built on the positions as decoded, which are
+    // dropped after
+    auto decoded = std::make_shared<std::vector<glm::vec3>>(vertNum);
+    ParallelFor(vertNum, [&](size_t beg, size_t end, uint32_t) {
+        for (auto v = beg; v < end; ++v)
+            (*decoded)[v] = packed->GetPosition(v);
+    });
+    auto ret = std::make_shared<MeshAssetImpl>(decoded, copy(colors), newIdxs,
+                                               nullptr, newUVIdxs, nullptr,
+                                               newNIdxs);
+    ret->GetOctree("");
+    ret->positions = StridedSpan<const glm::vec3>();
+    ret->posVec.reset();
+    ret->owners.erase(std::remove_if(ret->owners.begin(), ret->owners.end(),
+                                     [&](const auto &owner) {
+                                         return owner.get() == decoded.get();
+                                     }),
+                      ret->owners.end());
+    ret->compact = packed;
+    return ret;
+}
+
+void kouek::MeshAssetImpl::UpdatePositions(size_t first, size_t num) {
+    if (pages || compact)
+        return;
+    std::lock_guard<std::mutex> lock(otreeMtx);
+    if (num != 0)
+        ++dataVer;
+    // Built lazily from the current positions anyway
+    if (num == 0 || !otreeBuilt)
+        return;
+
+    if (vertFaceOffs.size() != positions.size() + 1) {
+        vertFaceOffs.assign(positions.size() + 1, 0);
+        for (auto vIdx : indices)
+            ++vertFaceOffs[vIdx + 1];
+        for (size_t vIdx = 0; vIdx < positions.size(); ++vIdx)
+            vertFaceOffs[vIdx + 1] += vertFaceOffs[vIdx];
+        vertFaces.resize(indices.size());
+        auto poses = vertFaceOffs;
+        for (size_t idxIdx = 0; idxIdx < indices.size(); ++idxIdx)
+            vertFaces[poses[indices[idxIdx]]++] = idxIdx / 3;
+        updFaces.assign(triangleNum, false);
+    }
+
+    std::vector<glm::uint> fIdxs;
+    for (auto vIdx = first; vIdx < first + num; ++vIdx)
+        for (auto i = vertFaceOffs[vIdx]; i < vertFaceOffs[vIdx + 1]; ++i)
+            if (auto fIdx = vertFaces[i]; !updFaces[fIdx]) {
+                updFaces[fIdx] = true;
+                fIdxs.emplace_back(fIdx);
+            }
+    for (auto fIdx : fIdxs)
+        updFaces[fIdx] = false;
+
+    auto leaves =
+        otree.Update(fIdxs, [&](glm::uint fIdx) { return genFaceAABB(fIdx); });
+    rebuildMeshlets(leaves);
+    markLODsDirty(leaves);
+}
+
+void kouek::MeshAssetImpl::AppendTriangles(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<glm::vec3> &colors,
+    const std::vector<glm::uint> &indices) {
+    if (pages || compact)
+        return;
+    std::lock_guard<std::mutex> lock(otreeMtx);
+    ++dataVer;
+    // Arrays shared with the caller or borrowed are copied into vectors
+    // of the asset once, growing geometrically after, so the cost is
+    // amortized to the chunk size
+    auto toVector = [&](auto &vec, const auto &view) {
+        using ElemTy = std::decay_t<decltype(view[0])>;
+        if (!vecsOwned || !vec)
+            vec = std::make_shared<std::vector<ElemTy>>(view.begin(),
+                                                        view.end());
+    };
+    toVector(posVec, this->positions);
+    toVector(colVec, this->colors);
+    toVector(idxVec, this->indices);
+    toVector(uvVec, uvs);
+    toVector(uvIdxVec, uvIndices);
+    toVector(normVec, norms);
+    toVector(nIdxVec, nIndices);
+    vecsOwned = true;
+    auto hasColors = !colVec->empty() || (posVec->empty() && !colors.empty());
+    // Lit by the normals of faces, as Mesh generates them, if created
+    auto hasNorms = !nIdxVec->empty() || posVec->empty();
+    auto hasUVs = !uvIdxVec->empty();
+
+    auto vOffs = (glm::uint)posVec->size();
+    posVec->insert(posVec->end(), positions.begin(), positions.end());
+    if (hasColors) {
+        if (colors.size() == positions.size())
+            colVec->insert(colVec->end(), colors.begin(), colors.end());
+        else
+            colVec->resize(posVec->size(), glm::vec3{1.f});
+        this->colors = *colVec;
+    }
+    for (auto idx : indices)
+        idxVec->emplace_back(vOffs + idx);
+    this->positions = *posVec;
+    this->indices = *idxVec;
+
+    // The texture data covers the new faces too, each taking the normal
+    // of its plane and uv (0, 0)
+    if (hasNorms) {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            auto &p0 = positions[indices[i + 0]];
+            auto nIdx = (glm::uint)normVec->size();
+            normVec->emplace_back(glm::cross(positions[indices[i + 1]] - p0,
+                                             positions[indices[i + 2]] - p0));
+            nIdxVec->insert(nIdxVec->end(), 3, nIdx);
+        }
+        norms = *normVec;
+        nIndices = *nIdxVec;
+    }
+    if (hasUVs) {
+        auto uvIdx = (glm::uint)uvVec->size();
+        uvVec->emplace_back(0.f);
+        uvIdxVec->insert(uvIdxVec->end(), indices.size(), uvIdx);
+        uvs = *uvVec;
+        uvIndices = *uvIdxVec;
+    }
+
+    auto prevTriNum = (glm::uint)triangleNum;
+    triangleNum = this->indices.size() / 3;
+    vertFaceOffs.clear();
+    vertFaces.clear();
+    if (!otreeBuilt || triangleNum == prevTriNum)
+        return;
+
+    // Rebuild once the mesh doubles, which keeps both the amortized cost
+    // and the octree quality bounded as it grows past the root AABB
+    if (triangleNum >= 2 * builtTriNum) {
+        otreeBuilt = false;
+        return;
+    }
+    std::vector<glm::uint> fIdxs(triangleNum - prevTriNum);
+    for (glm::uint i = 0; i < fIdxs.size(); ++i)
+        fIdxs[i] = prevTriNum + i;
+    auto leaves =
+        otree.Insert(fIdxs, [&](glm::uint fIdx) { return genFaceAABB(fIdx); });
+    rebuildMeshlets(leaves);
+    markLODsDirty(leaves);
+}
+
+void kouek::MeshAssetImpl::SetTextureData(
+    StridedSpan<const glm::vec2> uvs, StridedSpan<const glm::uint> uvIndices,
+    StridedSpan<const glm::vec3> norms, StridedSpan<const glm::uint> nIndices) {
+    std::lock_guard<std::mutex> lock(otreeMtx);
+    auto toVector = [](auto &vec, auto &view, const auto &src) {
+        using ElemTy = std::decay_t<decltype(src[0])>;
+        vec = std::make_shared<std::vector<ElemTy>>(src.begin(), src.end());
+        view = *vec;
+    };
+    toVector(uvVec, this->uvs, uvs);
+    toVector(uvIdxVec, this->uvIndices, uvIndices);
+    toVector(normVec, this->norms, norms);
+    toVector(nIdxVec, this->nIndices, nIndices);
+}
+
+uint64_t kouek::MeshAssetImpl::hashMesh() const {
+    // The octree only depends on positions and indices
+    // Of the elements as packed, whatever the strides
+    auto hashView = [](const auto &view, uint64_t seed) {
+        if (view.IsContiguous())
+            return Hash64(view.data(), sizeof(view[0]) * view.size(), seed);
+        auto packed = packView(view);
+        return Hash64(packed.data(), packed.size(), seed);
+    };
+    return hashView(indices, hashView(positions, 0));
+}
+
+void kouek::MeshAssetImpl::buildOctree(const std::string &cacheDir) const {
+    otreeBuilt = true;
+    ++otreeVer;
+    builtTriNum = triangleNum;
+
+    std::string cachePath;
+    uint64_t meshHash = 0;
+    if (!cacheDir.empty()) {
+        meshHash = hashMesh();
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "otree_%016llx_%u_%u.bin",
+                      (unsigned long long)meshHash, (unsigned)OctreeTy::CAP,
+                      (unsigned)OctreeTy::HEIGHT);
+        cachePath = (std::filesystem::path(cacheDir) / name).string();
+        if (otree.Load(cachePath, meshHash)) {
+            std::cout << ">> Octree loaded from " << cachePath << std::endl;
+            std::cout << otree << std::endl;
+            return;
+        }
+    }
+
+    std::vector<OctreeTy::AABB> aabbs(triangleNum);
+    std::vector<glm::uint> is(triangleNum);
+
+    std::vector<OctreeTy::AABB> rootAABBs(GetThreadNum());
+    ParallelFor(triangleNum, [&](size_t beg, size_t end, uint32_t chunkIdx) {
+        auto &rootAABB = rootAABBs[chunkIdx];
+        for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+            rootAABB.min[xyz] = std::numeric_limits<float>::max();
+            rootAABB.max[xyz] = std::numeric_limits<float>::lowest();
+        }
+        for (auto fIdx = (glm::uint)beg; fIdx < end; ++fIdx) {
+            auto &aabb = aabbs[fIdx];
+            aabb = genFaceAABB(fIdx);
+            for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+                if (rootAABB.min[xyz] > aabb.min[xyz])
+                    rootAABB.min[xyz] = aabb.min[xyz];
+                if (rootAABB.max[xyz] < aabb.max[xyz])
+                    rootAABB.max[xyz] = aabb.max[xyz];
+            }
+
+            is[fIdx] = fIdx;
+        }
+    });
+
+    auto rootAABB = rootAABBs[0];
+    for (uint32_t c = 1; c < std::min<size_t>(GetThreadNum(), triangleNum);
+         ++c)
+        for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+            if (rootAABB.min[xyz] > rootAABBs[c].min[xyz])
+                rootAABB.min[xyz] = rootAABBs[c].min[xyz];
+            if (rootAABB.max[xyz] < rootAABBs[c].max[xyz])
+                rootAABB.max[xyz] = rootAABBs[c].max[xyz];
+        }
+
+    otree.Reset(rootAABB);
+    otree.Build(aabbs, is);
+    if (!cachePath.empty() && !otree.Save(cachePath, meshHash))
+        std::cout << ">> Failed to save Octree to " << cachePath << std::endl;
+    std::cout << otree << std::endl;
+}
+
+void kouek::MeshAssetImpl::buildMeshlets() const {
+    auto &nodes = otree.GetNodes();
+    auto &leafIndices = otree.GetLeafIndices();
+    meshlets.Build(
+        nodes.size(),
+        [&](glm::uint lnIdx) {
+            auto &node = nodes[lnIdx];
+            return node.isLeaf ? Span<const glm::uint>(
+                                     leafIndices.data() + node.first, node.dat)
+                               : Span<const glm::uint>();
+        },
+        indices, positions);
+}
+
+void kouek::MeshAssetImpl::rebuildMeshlets(
+    const std::vector<glm::uint> &leaves) {
+    auto &nodes = otree.GetNodes();
+    auto &leafIndices = otree.GetLeafIndices();
+    for (auto lnIdx : leaves)
+        meshlets.Rebuild(
+            lnIdx,
+            Span<const glm::uint>(leafIndices.data() + nodes[lnIdx].first,
+                                  nodes[lnIdx].dat),
+            indices, positions);
+}
+
+void kouek::MeshAssetImpl::buildLODs() const {
+    auto &nodes = otree.GetNodes();
+    auto &leafIndices = otree.GetLeafIndices();
+    if (!lodsBuilt) {
+        lods.proxies.assign(nodes.size(), LODProxy{0.f, 0, 0});
+        lods.faces.clear();
+        lodParents.assign(nodes.size(), 0);
+        lodDirties.assign(nodes.size(), false);
+        lodGarbageNum = 0;
+        for (glm::uint lnIdx = 0; lnIdx < nodes.size(); ++lnIdx) {
+            if (nodes[lnIdx].isLeaf)
+                continue;
+            for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                lodParents[nodes[lnIdx].first + chIdx] = lnIdx;
+            lodDirties[lnIdx] = true;
+        }
+        lodsBuilt = true;
+    }
+
+    // Proxies only keep vertex indices, take the attributes of any corner
+    auto vertNum = compact ? compact->positions.size() : positions.size();
+    if (lods.vertCorners.size() != vertNum) {
+        lods.vertCorners.assign(vertNum, 0);
+        for (glm::uint i = 0; i < indices.size(); ++i)
+            lods.vertCorners[indices[i]] = i;
+    }
+
+    // Bottom-up, each round on the dirty nodes without dirty children
+    std::vector<glm::uint> readies;
+    std::vector<std::vector<std::array<glm::uint, 3>>> faces;
+    std::vector<float> errs;
+    // Compact ones decoded for the while, once any node is simplified
+    std::vector<glm::vec3> decoded;
+    auto poses = positions;
+    while (true) {
+        readies.clear();
+        for (glm::uint lnIdx = 0; lnIdx < nodes.size(); ++lnIdx) {
+            if (!lodDirties[lnIdx])
+                continue;
+            bool ready = true;
+            for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                if (lodDirties[nodes[lnIdx].first + chIdx]) {
+                    ready = false;
+                    break;
+                }
+            if (ready)
+                readies.emplace_back(lnIdx);
+        }
+        if (readies.empty())
+            break;
+        if (compact && decoded.empty()) {
+            decoded.resize(vertNum);
+            for (glm::uint vIdx = 0; vIdx < vertNum; ++vIdx)
+                decoded[vIdx] = compact->GetPosition(vIdx);
+            poses = decoded;
+        }
+
+        faces.resize(readies.size());
+        errs.resize(readies.size());
+        ParallelFor(readies.size(), [&](size_t beg, size_t end, uint32_t) {
+            for (auto i = beg; i < end; ++i) {
+                auto &node = nodes[readies[i]];
+                auto &fs = faces[i];
+                fs.clear();
+                errs[i] = 0.f;
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx) {
+                    auto &ch = nodes[node.first + chIdx];
+                    if (ch.isLeaf) {
+                        for (auto j = ch.first; j < ch.first + ch.dat; ++j) {
+                            auto idxIdx = leafIndices[j] * 3;
+                            fs.push_back({indices[idxIdx + 0],
+                                          indices[idxIdx + 1],
+                                          indices[idxIdx + 2]});
+                        }
+                        continue;
+                    }
+                    auto &proxy = lods.proxies[node.first + chIdx];
+                    errs[i] = std::max(errs[i], proxy.err);
+                    fs.insert(fs.end(), lods.faces.begin() + proxy.first,
+                              lods.faces.begin() + proxy.first + proxy.num);
+                }
+                // About as many faces as a leaf covering the same pixels
+                if (fs.size() > OctreeTy::CAP / 2)
+                    errs[i] +=
+                        SimplifyTriangles(fs, poses, OctreeTy::CAP / 2);
+            }
+        });
+
+        for (size_t i = 0; i < readies.size(); ++i) {
+            auto &proxy = lods.proxies[readies[i]];
+            lodGarbageNum += proxy.num;
+            proxy.err = errs[i];
+            proxy.first = lods.faces.size();
+            proxy.num = faces[i].size();
+            lods.faces.insert(lods.faces.end(), faces[i].begin(),
+                              faces[i].end());
+            lodDirties[readies[i]] = false;
+        }
+    }
+
+    if (lodGarbageNum > lods.faces.size() / 2) {
+        std::vector<std::array<glm::uint, 3>> compacted;
+        compacted.reserve(lods.faces.size() - lodGarbageNum);
+        for (auto &proxy : lods.proxies) {
+            auto first = compacted.size();
+            compacted.insert(compacted.end(), lods.faces.begin() + proxy.first,
+                             lods.faces.begin() + proxy.first + proxy.num);
+            proxy.first = first;
+        }
+        lods.faces = std::move(compacted);
+        lodGarbageNum = 0;
+    }
+}
+
+void kouek::MeshAssetImpl::markLODsDirty(
+    const std::vector<glm::uint> &leaves) {
+    if (!lodsBuilt)
+        return;
+    for (auto lnIdx : leaves)
+        while (lnIdx != 0) {
+            lnIdx = lodParents[lnIdx];
+            if (lodDirties[lnIdx])
+                break;
+            lodDirties[lnIdx] = true;
+        }
+}
+
+kouek::MeshAssetImpl::OctreeTy::AABB
+kouek::MeshAssetImpl::genFaceAABB(glm::uint fIdx) const {
+    auto idxIdx = fIdx * 3;
+    std::array<glm::uint, 3> vIdx3;
+    vIdx3[0] = indices[idxIdx + 0];
+    vIdx3[1] = indices[idxIdx + 1];
+    vIdx3[2] = indices[idxIdx + 2];
+
+    OctreeTy::AABB aabb;
+    for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+        aabb.min[xyz] = std::numeric_limits<float>::max();
+        aabb.max[xyz] = std::numeric_limits<float>::lowest();
+    }
+    for (uint8_t v = 0; v < 3; ++v)
+        for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+            if (aabb.min[xyz] > positions[vIdx3[v]][xyz])
+                aabb.min[xyz] = positions[vIdx3[v]][xyz];
+            if (aabb.max[xyz] < positions[vIdx3[v]][xyz])
+                aabb.max[xyz] = positions[vIdx3[v]][xyz];
+        }
+    return aabb;
+}
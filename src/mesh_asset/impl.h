@@ -0,0 +1,341 @@
+#ifndef KOUEK_MESH_ASSET_IMPL_H
+#define KOUEK_MESH_ASSET_IMPL_H
+
+#include <mesh_asset.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include <util/meshlet.hpp>
+#include <util/octree.hpp>
+#include <util/page_cache.hpp>
+#include <util/simplify.hpp>
+
+namespace kouek {
+
+class MeshAssetImpl : public MeshAsset {
+  public:
+    using OctreeTy = Octree<glm::uint, 512, 10>;
+    // grouped by octree node, only leaves have any
+    using MeshletsTy = Meshlets<glm::uint, 64, 128>;
+
+    // into vectors shared with the caller, or memory owners keep alive,
+    // empty if absent
+    StridedSpan<const glm::vec3> positions;
+    StridedSpan<const glm::vec3> colors;
+    StridedSpan<const glm::uint> indices;
+    StridedSpan<const glm::vec2> uvs;
+    StridedSpan<const glm::uint> uvIndices;
+    StridedSpan<const glm::vec3> norms;
+    StridedSpan<const glm::uint> nIndices;
+    size_t triangleNum = 0;
+
+    // Vertex attributes of an asset made by Compact(), decoded where
+    // rasterizers fetch them in the vertex stage
+    struct CompactVerts {
+        // Positions are quantized in the AABB of each run of vertices,
+        // which after Reorder() are those first used by a leaf or two
+        static constexpr glm::uint RUN_VERT_NUM = 256;
+        struct Run {
+            glm::vec3 min;
+            // of a quantization step
+            glm::vec3 step;
+        };
+        std::vector<Run> runs;
+        std::vector<glm::u16vec3> positions;
+        // octahedral, taking nIndices
+        std::vector<glm::u16vec2> norms;
+        // normals are those of faces, computed from positions, if set
+        bool faceNorms = false;
+        // quantized in [uvMin, uvMin + uvStep * 65535], taking uvIndices
+        std::vector<glm::u16vec2> uvs;
+        glm::vec2 uvMin, uvStep;
+
+        glm::vec3 GetPosition(glm::uint vIdx) const {
+            auto &run = runs[vIdx / RUN_VERT_NUM];
+            return run.min + run.step * glm::vec3(positions[vIdx]);
+        }
+        glm::vec2 GetUV(glm::uint uvIdx) const {
+            return uvMin + uvStep * glm::vec2(uvs[uvIdx]);
+        }
+        glm::vec3 GetNormal(glm::uint nIdx) const {
+            auto e = glm::vec2(norms[nIdx]) * (2.f / 65535.f) - 1.f;
+            glm::vec3 n{e.x, e.y, 1.f - fabsf(e.x) - fabsf(e.y)};
+            // Lower half folded out over the corners
+            auto t = std::max(-n.z, 0.f);
+            n.x += n.x >= 0.f ? -t : t;
+            n.y += n.y >= 0.f ? -t : t;
+            return glm::normalize(n);
+        }
+    };
+    // in the place of positions, and of uvs and norms if those are empty,
+    // of an asset made by Compact(), or nullptr
+    std::shared_ptr<const CompactVerts> compact;
+
+    // Simplified stand-in for the faces under an inner octree node
+    struct LODProxy {
+        // estimated distance from the faces it stands for
+        float err;
+        // faces at [first, first + num) of LODs::faces, none if num is 0
+        glm::uint first;
+        glm::uint num;
+    };
+    struct LODs {
+        // by octree node
+        std::vector<LODProxy> proxies;
+        // vertex indices of proxy faces
+        std::vector<std::array<glm::uint, 3>> faces;
+        // by vertex, any face corner (index into indices) using it, whose
+        // uv and normal indices proxy faces take
+        std::vector<glm::uint> vertCorners;
+    };
+
+    // Faces of an octree leaf of a paged asset, with arrays of their own
+    // laid out as those of the asset
+    struct LeafPage {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> colors;
+        std::vector<glm::uint> indices;
+        std::vector<glm::vec2> uvs;
+        std::vector<glm::uint> uvIndices;
+        std::vector<glm::vec3> norms;
+        std::vector<glm::uint> nIndices;
+
+        size_t GetByteNum() const {
+            return sizeof(LeafPage) +
+                   sizeof(glm::vec3) *
+                       (positions.size() + colors.size() + norms.size()) +
+                   sizeof(glm::vec2) * uvs.size() +
+                   sizeof(glm::uint) *
+                       (indices.size() + uvIndices.size() + nIndices.size());
+        }
+    };
+
+  private:
+    // File written by Save(), as aligned sections of arrays
+    static constexpr uint32_t FILE_MAGIC = 0x48534d4b; // "KMSH"
+    static constexpr uint32_t FILE_VERSION = 1;
+    static constexpr uint64_t FILE_ALIGNMENT = 64;
+    enum FileSection : uint8_t {
+        SEC_POSITIONS = 0,
+        SEC_COLORS,
+        SEC_INDICES,
+        SEC_UVS,
+        SEC_UV_INDICES,
+        SEC_NORMS,
+        SEC_N_INDICES,
+        // Serialize() of otree, as bytes
+        SEC_OCTREE,
+        SEC_MESHLET_GROUPS,
+        SEC_MESHLETS,
+        SEC_MESHLET_VERTS,
+        SEC_MESHLET_FACES,
+        SEC_MESHLET_TRIS,
+        SEC_NUM
+    };
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        // hash of positions and indices, keying otree
+        uint64_t key;
+        struct {
+            uint64_t offs;
+            uint64_t elemSz;
+            uint64_t num;
+        } sections[SEC_NUM];
+    };
+
+    // File written by SaveCompressed(), as a table of chunks coding
+    // ranges of the arrays of FileSection up to SEC_N_INDICES
+    static constexpr uint32_t COMP_FILE_MAGIC = 0x5a534d4b; // "KMSZ"
+    static constexpr uint32_t COMP_FILE_VERSION = 1;
+    struct CompFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t posBits;
+        uint32_t reserved;
+        // positions are quantized in it
+        OctreeTy::AABB aabb;
+        uint64_t nums[SEC_N_INDICES + 1];
+        uint64_t chunkNum;
+    };
+    struct CompChunk {
+        uint64_t sec;
+        // elements [first, first + num) of the array, coded in byteNum
+        // bytes following the previous chunk
+        uint64_t first;
+        uint64_t num;
+        uint64_t byteNum;
+    };
+
+    // File written by SavePaged(), as Serialize() of otree without leaf
+    // indices, a page range per octree node, and the pages of leaves
+    static constexpr uint32_t PAGED_FILE_MAGIC = 0x504d534b; // "KMSP"
+    static constexpr uint32_t PAGED_FILE_VERSION = 1;
+    struct PagedFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t triangleNum;
+        OctreeTy::AABB aabb;
+        uint64_t otreeOffs;
+        uint64_t otreeSz;
+        uint64_t pageTableOffs;
+        uint64_t nodeNum;
+    };
+    // of a page, none if byteNum is 0
+    struct PageRange {
+        uint64_t offs;
+        uint64_t byteNum;
+    };
+    // Followed by the arrays of LeafPage in the order of FileSection
+    struct PageHeader {
+        uint32_t nums[SEC_N_INDICES + 1];
+    };
+
+    // Guards the lazy build of otree against concurrent rasterizers
+    mutable std::mutex otreeMtx;
+    mutable OctreeTy otree;
+    mutable MeshletsTy meshlets;
+    mutable bool otreeBuilt = false;
+    // bumped whenever otree is built, which renumbers its nodes
+    mutable glm::uint otreeVer = 0;
+    // face num when otree was last built
+    mutable size_t builtTriNum = 0;
+    // bumped whenever the vertex data changes
+    glm::uint dataVer = 0;
+
+    mutable LODs lods;
+    mutable bool lodsBuilt = false;
+    // parents of octree nodes, and inner nodes whose proxy is outdated
+    mutable std::vector<glm::uint> lodParents;
+    mutable std::vector<bool> lodDirties;
+    mutable size_t lodGarbageNum = 0;
+
+    std::vector<std::shared_ptr<const void>> owners;
+    // vectors the views above are of, if any, which AppendTriangles()
+    // grows once they are owned by this asset alone
+    std::shared_ptr<std::vector<glm::vec3>> posVec;
+    std::shared_ptr<std::vector<glm::vec3>> colVec;
+    std::shared_ptr<std::vector<glm::uint>> idxVec;
+    std::shared_ptr<std::vector<glm::vec2>> uvVec;
+    std::shared_ptr<std::vector<glm::uint>> uvIdxVec;
+    std::shared_ptr<std::vector<glm::vec3>> normVec;
+    std::shared_ptr<std::vector<glm::uint>> nIdxVec;
+    bool vecsOwned = false;
+
+    // faces using each vertex as CSR, for UpdatePositions()
+    std::vector<glm::uint> vertFaceOffs;
+    std::vector<glm::uint> vertFaces;
+    std::vector<bool> updFaces;
+
+    // Of a paged asset, whose arrays above are empty
+    std::string pagedPath;
+    std::vector<PageRange> pageRanges;
+    AABB pagedAABB;
+    // idle streams of pagedPath, reused across reads
+    mutable std::mutex streamMtx;
+    mutable std::vector<std::unique_ptr<std::ifstream>> streams;
+    // by node index, reading with the above, so destroyed first
+    std::unique_ptr<PageCache<glm::uint, LeafPage>> pages;
+
+  public:
+    MeshAssetImpl(std::shared_ptr<std::vector<glm::vec3>> positions,
+                  std::shared_ptr<std::vector<glm::vec3>> colors,
+                  std::shared_ptr<std::vector<glm::uint>> indices,
+                  std::shared_ptr<std::vector<glm::vec2>> uvs,
+                  std::shared_ptr<std::vector<glm::uint>> uvIndices,
+                  std::shared_ptr<std::vector<glm::vec3>> norms,
+                  std::shared_ptr<std::vector<glm::uint>> nIndices);
+    MeshAssetImpl(StridedSpan<const glm::vec3> positions,
+                  StridedSpan<const glm::vec3> colors,
+                  StridedSpan<const glm::uint> indices,
+                  StridedSpan<const glm::vec2> uvs,
+                  StridedSpan<const glm::uint> uvIndices,
+                  StridedSpan<const glm::vec3> norms,
+                  StridedSpan<const glm::uint> nIndices,
+                  std::shared_ptr<const void> owner);
+
+    virtual size_t GetTriangleNum() const override { return triangleNum; }
+    virtual AABB GetAABB() const override;
+    virtual bool Save(const std::string &path) const override;
+    virtual bool SaveCompressed(const std::string &path,
+                                uint32_t posBits) const override;
+    virtual bool SavePaged(const std::string &path) const override;
+    virtual std::shared_ptr<const MeshAsset> Weld() const override;
+    virtual std::shared_ptr<const MeshAsset> Reorder() const override;
+    virtual std::shared_ptr<const MeshAsset> Compact() const override;
+    // Called while a file written by SaveCompressed() is decoded, from
+    // any loader thread, as faces [first, first + num) and the positions
+    // and colors they index become ready. Returns false to stop loading.
+    using OnFacesLoaded = std::function<bool(
+        const std::vector<glm::vec3> &positions,
+        const std::vector<glm::vec3> &colors,
+        const std::vector<glm::uint> &indices, size_t first, size_t num)>;
+    static std::shared_ptr<MeshAssetImpl>
+    Load(const std::string &path, size_t pageBudget = DEFAULT_PAGE_BUDGET,
+         const OnFacesLoaded &onFaces = nullptr);
+
+    // Faces are only in the pages of leaves if loaded from a file written
+    // by SavePaged()
+    bool IsPaged() const { return pages != nullptr; }
+    // The page of a leaf, read now if it is not cached, or nullptr if it
+    // has no faces or can't be read
+    std::shared_ptr<const LeafPage> GetLeafPage(glm::uint nodeIdx) const {
+        return pages->Get(nodeIdx);
+    }
+    // Read the page of a leaf likely needed soon in the background
+    void PrefetchLeafPage(glm::uint nodeIdx) const {
+        pages->Prefetch(nodeIdx);
+    }
+    // Called by rasterizers at the start of each frame. Prefetching never
+    // evicts pages used in this or the last frame.
+    void NextPageFrame() const { pages->NextFrame(); }
+
+    // Build the octree on the first call, loading it from / saving it to
+    // cacheDir if it is not empty
+    const OctreeTy &GetOctree(const std::string &cacheDir) const;
+    glm::uint GetOctreeVersion() const { return otreeVer; }
+    glm::uint GetDataVersion() const { return dataVer; }
+    // Valid once GetOctree() is called
+    const MeshletsTy &GetMeshlets() const { return meshlets; }
+    // Build or update the proxies on the first call after the octree
+    // changed. Valid once GetOctree() is called.
+    const LODs &GetLODs() const;
+
+    // A private, deep copy of the vertex data, without the octree
+    std::shared_ptr<MeshAssetImpl> Clone() const;
+    void UpdatePositions(size_t first, size_t num);
+    void AppendTriangles(const std::vector<glm::vec3> &positions,
+                         const std::vector<glm::vec3> &colors,
+                         const std::vector<glm::uint> &indices);
+    // Take a copy of texture data set on a rasterizer alone, to extend it
+    // along with the vertex data
+    void SetTextureData(StridedSpan<const glm::vec2> uvs,
+                        StridedSpan<const glm::uint> uvIndices,
+                        StridedSpan<const glm::vec3> norms,
+                        StridedSpan<const glm::uint> nIndices);
+
+  private:
+    static std::shared_ptr<MeshAssetImpl>
+    loadCompressed(const std::string &path, const OnFacesLoaded &onFaces);
+    static std::shared_ptr<MeshAssetImpl>
+    loadPaged(std::shared_ptr<MappedFile> file, const std::string &path,
+              size_t pageBudget);
+    std::shared_ptr<const LeafPage> readLeafPage(glm::uint nodeIdx) const;
+    uint64_t hashMesh() const;
+    void buildOctree(const std::string &cacheDir) const;
+    void buildMeshlets() const;
+    void rebuildMeshlets(const std::vector<glm::uint> &leaves);
+    void buildLODs() const;
+    void markLODsDirty(const std::vector<glm::uint> &leaves);
+    OctreeTy::AABB genFaceAABB(glm::uint fIdx) const;
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_MESH_ASSET_IMPL_H
@@ -0,0 +1,117 @@
+#include "impl.h"
+
+#include <unordered_map>
+
+#include <util/mesh.hpp>
+
+std::unique_ptr<kouek::MeshStreamer>
+kouek::MeshStreamer::Create(const std::string &path,
+                            const std::string &cacheDir) {
+    return std::make_unique<MeshStreamerImpl>(path, cacheDir);
+}
+
+kouek::MeshStreamerImpl::MeshStreamerImpl(const std::string &path,
+                                          const std::string &cacheDir)
+    : path(path), cacheDir(cacheDir) {
+    loader = std::thread([this]() { load(); });
+}
+
+kouek::MeshStreamerImpl::~MeshStreamerImpl() {
+    stopped = true;
+    loader.join();
+}
+
+bool kouek::MeshStreamerImpl::PopChunk(Chunk &chunk) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (chunks.empty())
+        return false;
+    chunk = std::move(chunks.front());
+    chunks.pop();
+    return true;
+}
+
+std::shared_ptr<const kouek::MeshAsset>
+kouek::MeshStreamerImpl::GetAsset() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return asset;
+}
+
+bool kouek::MeshStreamerImpl::IsDone() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return done;
+}
+
+std::string kouek::MeshStreamerImpl::GetError() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return err;
+}
+
+void kouek::MeshStreamerImpl::load() {
+    std::shared_ptr<const MeshAssetImpl> loaded;
+    std::string loadErr;
+    std::atomic<size_t> pushedNum = 0;
+    loaded = MeshAssetImpl::Load(
+        path, MeshAsset::DEFAULT_PAGE_BUDGET,
+        [&](const std::vector<glm::vec3> &positions,
+            const std::vector<glm::vec3> &colors,
+            const std::vector<glm::uint> &indices, size_t first, size_t num) {
+            ++pushedNum;
+            return pushFaces(positions, colors, indices, first, num);
+        });
+    if (!loaded && stopped)
+        return;
+    if (!loaded && pushedNum != 0)
+        loadErr = "Corrupt compressed mesh file.";
+    else if (!loaded)
+        try {
+            // Borrowed in place, the mesh lives as long as the asset
+            auto mesh = std::make_shared<Mesh>();
+            mesh->ReadFromFile(path);
+            auto &fvts = mesh->GetFVTS();
+            auto &fvns = mesh->GetFVNS();
+            loaded = std::make_shared<MeshAssetImpl>(
+                mesh->GetVS(), StridedSpan<const glm::vec3>(),
+                Mesh::ToIndices(mesh->GetFVS()),
+                fvts.empty() ? StridedSpan<const glm::vec2>()
+                             : mesh->GetVTS(),
+                Mesh::ToIndices(fvts),
+                fvns.empty() ? StridedSpan<const glm::vec3>()
+                             : mesh->GetVNS(),
+                Mesh::ToIndices(fvns), mesh);
+        } catch (std::exception &exp) {
+            loadErr = exp.what();
+        }
+
+    // Built here rather than in the first Render() after the swap
+    if (loaded && !stopped)
+        loaded->GetOctree(cacheDir);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    asset = loaded;
+    err = loadErr;
+    done = true;
+}
+
+bool kouek::MeshStreamerImpl::pushFaces(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<glm::vec3> &colors,
+    const std::vector<glm::uint> &indices, size_t first, size_t num) {
+    // Vertices shared with other chunks are duplicated into each of them
+    Chunk chunk;
+    std::unordered_map<glm::uint, glm::uint> old2News;
+    chunk.indices.reserve(num * 3);
+    for (auto i = first * 3; i < (first + num) * 3; ++i) {
+        auto [itr, inserted] = old2News.emplace(
+            indices[i], (glm::uint)chunk.positions.size());
+        if (inserted) {
+            chunk.positions.emplace_back(positions[indices[i]]);
+            if (!colors.empty())
+                chunk.colors.emplace_back(colors[indices[i]]);
+        }
+        chunk.indices.emplace_back(itr->second);
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    chunks.emplace(std::move(chunk));
+    return !stopped;
+}
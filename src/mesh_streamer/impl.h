@@ -0,0 +1,49 @@
+#ifndef KOUEK_MESH_STREAMER_IMPL_H
+#define KOUEK_MESH_STREAMER_IMPL_H
+
+#include <mesh_streamer.h>
+
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "../mesh_asset/impl.h"
+
+namespace kouek {
+
+class MeshStreamerImpl : public MeshStreamer {
+  private:
+    std::string path;
+    std::string cacheDir;
+
+    // Guards all below, written by loader
+    mutable std::mutex mtx;
+    std::queue<Chunk> chunks;
+    std::shared_ptr<const MeshAsset> asset;
+    std::string err;
+    bool done = false;
+
+    std::atomic<bool> stopped = false;
+    std::thread loader;
+
+  public:
+    MeshStreamerImpl(const std::string &path, const std::string &cacheDir);
+    ~MeshStreamerImpl();
+
+    virtual bool PopChunk(Chunk &chunk) override;
+    virtual std::shared_ptr<const MeshAsset> GetAsset() const override;
+    virtual bool IsDone() const override;
+    virtual std::string GetError() const override;
+
+  private:
+    void load();
+    bool pushFaces(const std::vector<glm::vec3> &positions,
+                   const std::vector<glm::vec3> &colors,
+                   const std::vector<glm::uint> &indices, size_t first,
+                   size_t num);
+};
+
+} // namespace kouek
+
+#endif // !KOUEK_MESH_STREAMER_IMPL_H
@@ -4,13 +4,75 @@ void kouek::RasterizerImpl::SetVertexData(
     std::shared_ptr<std::vector<glm::vec3>> positions,
     std::shared_ptr<std::vector<glm::vec3>> colors,
     std::shared_ptr<std::vector<glm::uint>> indices) {
-    this->positions = positions;
-    this->colors = colors;
-    this->indices = indices;
+    asset = std::make_shared<MeshAssetImpl>(positions, colors, indices,
+                                            nullptr, nullptr, nullptr,
+                                            nullptr);
+    assetShared = false;
+    viewAsset();
+}
+
+void kouek::RasterizerImpl::SetVertexData(
+    StridedSpan<const glm::vec3> positions,
+    StridedSpan<const glm::vec3> colors, StridedSpan<const glm::uint> indices,
+    std::shared_ptr<const void> owner) {
+    asset = std::make_shared<MeshAssetImpl>(
+        positions, colors, indices, StridedSpan<const glm::vec2>(),
+        StridedSpan<const glm::uint>(), StridedSpan<const glm::vec3>(),
+        StridedSpan<const glm::uint>(), owner);
+    assetShared = false;
+    viewAsset();
+}
 
-    triangleNum = indices->size() / 3;
+void kouek::RasterizerImpl::SetMeshAsset(
+    std::shared_ptr<const MeshAsset> asset) {
+    // Only this rasterizer's copy-on-write ever modifies it
+    this->asset = std::const_pointer_cast<MeshAssetImpl>(
+        std::static_pointer_cast<const MeshAssetImpl>(asset));
+    assetShared = true;
+    viewAsset();
+    uvs = this->asset->uvs;
+    uvIndices = this->asset->uvIndices;
+    norms = this->asset->norms;
+    nIndices = this->asset->nIndices;
+    texOwner.reset();
+    compactUVs = compact && !compact->uvs.empty();
+    compactNorms = compact && (compact->faceNorms || !compact->norms.empty());
+}
 
-    v2rs.resize(triangleNum);
+void kouek::RasterizerImpl::UpdatePositions(size_t first, size_t num) {
+    if (asset)
+        asset->UpdatePositions(first, num);
+}
+
+void kouek::RasterizerImpl::AppendTriangles(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<glm::vec3> &colors,
+    const std::vector<glm::uint> &indices) {
+    if (asset && (asset->IsPaged() || asset->compact))
+        return;
+    if (!asset)
+        asset = std::make_shared<MeshAssetImpl>(
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+    else if (assetShared) {
+        // Copy on write, other rasterizers keep drawing the shared one
+        asset = asset->Clone();
+        assetShared = false;
+    }
+    // Texture data set on this rasterizer alone is copied in, to be
+    // extended along with the vertex data
+    auto same = [](const auto &a, const auto &b) {
+        return a.data() == b.data() && a.size() == b.size();
+    };
+    if (!same(uvs, asset->uvs) || !same(uvIndices, asset->uvIndices) ||
+        !same(norms, asset->norms) || !same(nIndices, asset->nIndices))
+        asset->SetTextureData(uvs, uvIndices, norms, nIndices);
+    asset->AppendTriangles(positions, colors, indices);
+    viewAsset();
+    uvs = asset->uvs;
+    uvIndices = asset->uvIndices;
+    norms = asset->norms;
+    nIndices = asset->nIndices;
+    texOwner.reset();
 }
 
 void kouek::RasterizerImpl::SetTextureData(
@@ -18,10 +80,39 @@ void kouek::RasterizerImpl::SetTextureData(
     std::shared_ptr<std::vector<glm::uint>> uvIndices,
     std::shared_ptr<std::vector<glm::vec3>> norms,
     std::shared_ptr<std::vector<glm::uint>> nIndices) {
+    auto toView = [](const auto &vec) {
+        using ElemTy = typename std::decay_t<decltype(*vec)>::value_type;
+        return vec ? StridedSpan<const ElemTy>(*vec)
+                   : StridedSpan<const ElemTy>();
+    };
+    SetTextureData(toView(uvs), toView(uvIndices), toView(norms),
+                   toView(nIndices),
+                   std::make_shared<std::tuple<
+                       decltype(uvs), decltype(uvIndices), decltype(norms),
+                       decltype(nIndices)>>(uvs, uvIndices, norms, nIndices));
+}
+
+void kouek::RasterizerImpl::SetTextureData(
+    StridedSpan<const glm::vec2> uvs, StridedSpan<const glm::uint> uvIndices,
+    StridedSpan<const glm::vec3> norms, StridedSpan<const glm::uint> nIndices,
+    std::shared_ptr<const void> owner) {
     this->uvs = uvs;
     this->uvIndices = uvIndices;
     this->norms = norms;
     this->nIndices = nIndices;
+    texOwner = owner;
+    compactUVs = compactNorms = false;
+}
+
+void kouek::RasterizerImpl::viewAsset() {
+    positions = asset->positions;
+    colors = asset->colors;
+    indices = asset->indices;
+    compact = asset->compact.get();
+    if (!compact)
+        compactUVs = compactNorms = false;
+    // Only the hierarchical rasterizer reaches the faces of a paged asset
+    triangleNum = indices.size() / 3;
 }
 
 void kouek::RasterizerImpl::SetRenderSize(const glm::uvec2 &rndrSz) {
@@ -37,7 +128,41 @@ const std::vector<glm::u8vec4> &kouek::RasterizerImpl::GetColorOutput() {
     return colorOutput;
 }
 
-void kouek::RasterizerImpl::runPreRasterization() {
+bool kouek::RasterizerImpl::processFace(
+    glm::uint fIdx, V2R &v2r, const std::array<glm::vec4, 3> *clipPos3,
+    bool cullBack) {
+    std::array<glm::uint, 3> vIdx3;
+    std::array<glm::uint, 3> uvIdx3;
+    std::array<glm::uint, 3> nIdx3;
+    auto idxIdx = fIdx * 3;
+    vIdx3[0] = indices[idxIdx + 0];
+    vIdx3[1] = indices[idxIdx + 1];
+    vIdx3[2] = indices[idxIdx + 2];
+    // Welded vertices take uvs and normals by the same index, at no
+    // further fetch
+    if (uvIndices.data() == indices.data())
+        uvIdx3 = vIdx3;
+    else if (hasUVs()) {
+        uvIdx3[0] = uvIndices[idxIdx + 0];
+        uvIdx3[1] = uvIndices[idxIdx + 1];
+        uvIdx3[2] = uvIndices[idxIdx + 2];
+    }
+    // Normals of faces of a compact asset take none
+    if (nIndices.data() == indices.data())
+        nIdx3 = vIdx3;
+    else if (!nIndices.empty()) {
+        nIdx3[0] = nIndices[idxIdx + 0];
+        nIdx3[1] = nIndices[idxIdx + 1];
+        nIdx3[2] = nIndices[idxIdx + 2];
+    }
+    return processFace(vIdx3, uvIdx3, nIdx3, v2r, clipPos3, cullBack);
+}
+
+bool kouek::RasterizerImpl::processFace(
+    const std::array<glm::uint, 3> &vIdx3,
+    const std::array<glm::uint, 3> &uvIdx3,
+    const std::array<glm::uint, 3> &nIdx3, V2R &v2r,
+    const std::array<glm::vec4, 3> *clipPos3, bool cullBack) {
     auto pos32pos4 = [](glm::vec4 &o, const glm::vec3 &in) {
         o.x = in.x;
         o.y = in.y;
@@ -50,44 +175,44 @@ void kouek::RasterizerImpl::runPreRasterization() {
         o.z = in.z;
         o.w = 0.f;
     };
-    auto runVertexShader = [&](glm::uint tIdx) {
-        std::array<glm::uint, 3> vIdx3;
-        std::array<glm::uint, 3> uvIdx3;
-        std::array<glm::uint, 3> nIdx3;
-        {
-            auto idxIdx = tIdx * 3;
-            vIdx3[0] = (*indices)[idxIdx + 0];
-            vIdx3[1] = (*indices)[idxIdx + 1];
-            vIdx3[2] = (*indices)[idxIdx + 2];
-            if (uvs) {
-                uvIdx3[0] = (*uvIndices)[idxIdx + 0];
-                uvIdx3[1] = (*uvIndices)[idxIdx + 1];
-                uvIdx3[2] = (*uvIndices)[idxIdx + 2];
-            }
-            if (norms) {
-                nIdx3[0] = (*nIndices)[idxIdx + 0];
-                nIdx3[1] = (*nIndices)[idxIdx + 1];
-                nIdx3[2] = (*nIndices)[idxIdx + 2];
-            }
+    auto runVertexShader = [&]() {
+        // Normals of faces of a compact asset, as Mesh generates them
+        glm::vec3 faceNorm;
+        if (compactNorms && compact->faceNorms) {
+            auto p0 = compact->GetPosition(vIdx3[0]);
+            faceNorm = glm::cross(compact->GetPosition(vIdx3[1]) - p0,
+                                  compact->GetPosition(vIdx3[2]) - p0);
         }
 
         for (uint8_t t = 0; t < 3; ++t) {
-            auto &v2rDat = v2rs[tIdx].vs[t];
-            pos32pos4(v2rDat.pos, (*positions)[vIdx3[t]]);
+            auto &v2rDat = v2r.vs[t];
 
-            if (uvs)
-                v2rDat.surf.uv = (*uvs)[uvIdx3[t]];
-            else if (colors)
-                v2rDat.surf.col = (*colors)[vIdx3[t]];
+            if (!uvs.empty())
+                v2rDat.surf.uv = uvs[uvIdx3[t]];
+            else if (compactUVs)
+                v2rDat.surf.uv = compact->GetUV(uvIdx3[t]);
+            else if (!colors.empty())
+                v2rDat.surf.col = colors[vIdx3[t]];
 
-            if (norms) {
-                dir32dir4(v2rDat.norm, (*norms)[nIdx3[t]]);
-                pos32pos4(v2rDat.wdPos, (*positions)[vIdx3[t]]);
+            if (hasNorms()) {
+                if (!norms.empty())
+                    dir32dir4(v2rDat.norm, norms[nIdx3[t]]);
+                else
+                    dir32dir4(v2rDat.norm,
+                              compact->faceNorms
+                                  ? faceNorm
+                                  : compact->GetNormal(nIdx3[t]));
+                pos32pos4(v2rDat.wdPos, getPosition(vIdx3[t]));
             }
 
             // Local Space -> Camera Space
-            v2rDat.pos = MVP * v2rDat.pos;
-            if (norms) {
+            if (clipPos3)
+                v2rDat.pos = (*clipPos3)[t];
+            else {
+                pos32pos4(v2rDat.pos, getPosition(vIdx3[t]));
+                v2rDat.pos = MVP * v2rDat.pos;
+            }
+            if (hasNorms()) {
                 v2rDat.norm = M * v2rDat.norm;
                 v2rDat.wdPos = M * v2rDat.wdPos;
             }
@@ -102,12 +227,12 @@ void kouek::RasterizerImpl::runPreRasterization() {
             v2rDat.pos.y *= v2rDat.pos.w;
             v2rDat.pos.z *= v2rDat.pos.w;
 
-            if (uvs)
+            if (hasUVs())
                 v2rDat.surf.uv *= v2rDat.pos.w;
-            else if (colors)
+            else if (!colors.empty())
                 v2rDat.surf.col *= v2rDat.pos.w;
 
-            if (norms) {
+            if (hasNorms()) {
                 v2rDat.norm *= v2rDat.pos.w;
                 v2rDat.wdPos *= v2rDat.pos.w;
             }
@@ -154,16 +279,16 @@ void kouek::RasterizerImpl::runPreRasterization() {
                     v2r.vs[currValidVertCnt].pos =
                         tmp[S].pos + t * (tmp[P].pos - tmp[S].pos);
 
-                    if (uvs)
+                    if (hasUVs())
                         v2r.vs[currValidVertCnt].surf.uv =
                             tmp[S].surf.uv +
                             t * (tmp[P].surf.uv - tmp[S].surf.uv);
-                    else if (colors)
+                    else if (!colors.empty())
                         v2r.vs[currValidVertCnt].surf.col =
                             tmp[S].surf.col +
                             t * (tmp[P].surf.col - tmp[S].surf.col);
 
-                    if (norms) {
+                    if (hasNorms()) {
                         v2r.vs[currValidVertCnt].norm =
                             tmp[S].norm + t * (tmp[P].norm - tmp[S].norm);
                         v2r.vs[currValidVertCnt].wdPos =
@@ -184,47 +309,53 @@ void kouek::RasterizerImpl::runPreRasterization() {
         }
     };
 
-#ifdef SHOW_DRAW_FACE_NUM
-    glm::uint drawFaceCnt = 0;
-#endif // SHOW_DRAW_FACE_NUM
-    for (glm::uint fIdx = 0; fIdx < triangleNum; ++fIdx) {
-        auto &v2r = v2rs[fIdx];
-        v2r.vCnt = 0;
+    v2r.vCnt = 0;
 
-        // Vertex Shader
-        bool nearPlaneClipOK = runVertexShader(fIdx);
-        if (!nearPlaneClipOK)
-            continue;
+    // Vertex Shader
+    bool nearPlaneClipOK = runVertexShader();
+    if (!nearPlaneClipOK)
+        return false;
 
-        // Face Culling
+    // Face Culling
 #ifndef NO_BACK_FACE_CULL
-        {
-            glm::vec3 v0v1{v2r.vs[1].pos.x - v2r.vs[0].pos.x,
-                           v2r.vs[1].pos.y - v2r.vs[0].pos.y,
-                           v2r.vs[1].pos.z - v2r.vs[0].pos.z};
-            glm::vec3 v0v2{v2r.vs[2].pos.x - v2r.vs[0].pos.x,
-                           v2r.vs[2].pos.y - v2r.vs[0].pos.y,
-                           v2r.vs[2].pos.z - v2r.vs[0].pos.z};
-            v0v1 = glm::cross(v0v1, v0v2);
-            if (v0v1.z < 0) // cull back face
-                continue;
-        }
+    if (cullBack) {
+        glm::vec3 v0v1{v2r.vs[1].pos.x - v2r.vs[0].pos.x,
+                       v2r.vs[1].pos.y - v2r.vs[0].pos.y,
+                       v2r.vs[1].pos.z - v2r.vs[0].pos.z};
+        glm::vec3 v0v2{v2r.vs[2].pos.x - v2r.vs[0].pos.x,
+                       v2r.vs[2].pos.y - v2r.vs[0].pos.y,
+                       v2r.vs[2].pos.z - v2r.vs[0].pos.z};
+        v0v1 = glm::cross(v0v1, v0v2);
+        if (v0v1.z < 0) // cull back face
+            return false;
+    }
 #endif // !NO_BACK_FACE_CULL
 
-        // Perspective Clipping
-        runSutherlandHodgemanClip(v2r);
-        if (v2r.vCnt == 0)
-            continue;
+    // Perspective Clipping
+    runSutherlandHodgemanClip(v2r);
+    if (v2r.vCnt == 0)
+        return false;
+
+    // Camera Space -> Screen Space
+    for (uint8_t v = 0; v < v2r.vCnt; ++v) {
+        v2r.vs[v].pos.x = (v2r.vs[v].pos.x + 1.f) * .5f * rndrSz.x;
+        v2r.vs[v].pos.y = (v2r.vs[v].pos.y + 1.f) * .5f * rndrSz.y;
+    }
+    return true;
+}
 
+void kouek::RasterizerImpl::runPreRasterization() {
 #ifdef SHOW_DRAW_FACE_NUM
-        ++drawFaceCnt;
+    glm::uint drawFaceCnt = 0;
+#endif // SHOW_DRAW_FACE_NUM
+    v2rs.resize(triangleNum);
+    for (glm::uint fIdx = 0; fIdx < triangleNum; ++fIdx) {
+#ifdef SHOW_DRAW_FACE_NUM
+        if (processFace(fIdx, v2rs[fIdx]))
+            ++drawFaceCnt;
+#else
+        processFace(fIdx, v2rs[fIdx]);
 #endif // SHOW_DRAW_FACE_NUM
-
-        // Camera Space -> Screen Space
-        for (uint8_t v = 0; v < v2r.vCnt; ++v) {
-            v2r.vs[v].pos.x = (v2r.vs[v].pos.x + 1.f) * .5f * rndrSz.x;
-            v2r.vs[v].pos.y = (v2r.vs[v].pos.y + 1.f) * .5f * rndrSz.y;
-        }
     }
 
 #ifdef SHOW_DRAW_FACE_NUM
@@ -10,6 +10,8 @@
 
 #include <array>
 
+#include "../mesh_asset/impl.h"
+
 namespace kouek {
 
 class RasterizerImpl : virtual public Rasterizer {
@@ -26,13 +28,40 @@ class RasterizerImpl : virtual public Rasterizer {
 
     LightParam light;
 
-    std::shared_ptr<std::vector<glm::vec3>> positions;
-    std::shared_ptr<std::vector<glm::vec3>> colors;
-    std::shared_ptr<std::vector<glm::uint>> indices;
-    std::shared_ptr<std::vector<glm::vec2>> uvs;
-    std::shared_ptr<std::vector<glm::uint>> uvIndices;
-    std::shared_ptr<std::vector<glm::vec3>> norms;
-    std::shared_ptr<std::vector<glm::uint>> nIndices;
+    // model matrices of instances, none to draw once with M
+    std::vector<glm::mat4> instModels;
+    // bumped on adding or clearing instances, which renumbers them
+    glm::uint instVer = 0;
+    // bumped on any change to instModels
+    glm::uint instModelVer = 0;
+
+    bool depReproj = false;
+    std::string cacheDir;
+    float lodThreshold = 0.f;
+    size_t impostorBudget = 0;
+    float impostorAngTol = 0.f;
+    float impostorSizeTol = 0.f;
+    std::shared_ptr<const PVS> pvs;
+
+    // shared with other rasterizers if set by SetMeshAsset()
+    std::shared_ptr<MeshAssetImpl> asset;
+    bool assetShared = false;
+
+    // views of the asset's, but of texture data set by SetTextureData()
+    StridedSpan<const glm::vec3> positions;
+    StridedSpan<const glm::vec3> colors;
+    StridedSpan<const glm::uint> indices;
+    StridedSpan<const glm::vec2> uvs;
+    StridedSpan<const glm::uint> uvIndices;
+    StridedSpan<const glm::vec3> norms;
+    StridedSpan<const glm::uint> nIndices;
+    std::shared_ptr<const void> texOwner;
+    // of the asset if it is compact, whose positions are decoded in the
+    // vertex stage, as are its uvs and normals unless SetTextureData()
+    // sets others
+    const MeshAssetImpl::CompactVerts *compact = nullptr;
+    bool compactUVs = false;
+    bool compactNorms = false;
 
     struct V2RDat {
         glm::vec4 pos;
@@ -58,16 +87,47 @@ class RasterizerImpl : virtual public Rasterizer {
     SetVertexData(std::shared_ptr<std::vector<glm::vec3>> positions,
                   std::shared_ptr<std::vector<glm::vec3>> colors,
                   std::shared_ptr<std::vector<glm::uint>> indices) override;
+    virtual void SetVertexData(StridedSpan<const glm::vec3> positions,
+                               StridedSpan<const glm::vec3> colors,
+                               StridedSpan<const glm::uint> indices,
+                               std::shared_ptr<const void> owner) override;
+    virtual void
+    SetMeshAsset(std::shared_ptr<const MeshAsset> asset) override;
+    virtual void UpdatePositions(size_t first, size_t num) override;
+    virtual void AppendTriangles(const std::vector<glm::vec3> &positions,
+                                 const std::vector<glm::vec3> &colors,
+                                 const std::vector<glm::uint> &indices) override;
     virtual void
     SetTextureData(std::shared_ptr<std::vector<glm::vec2>> uvs,
                    std::shared_ptr<std::vector<glm::uint>> uvIndices,
                    std::shared_ptr<std::vector<glm::vec3>> norms,
                    std::shared_ptr<std::vector<glm::uint>> nIndices) override;
+    virtual void SetTextureData(StridedSpan<const glm::vec2> uvs,
+                                StridedSpan<const glm::uint> uvIndices,
+                                StridedSpan<const glm::vec3> norms,
+                                StridedSpan<const glm::uint> nIndices,
+                                std::shared_ptr<const void> owner) override;
     virtual void SetLight(const LightParam &param) override { light = param; }
     virtual void SetModel(const glm::mat4 &model) override {
         M = model;
         MVP = P * V * M;
     }
+    virtual glm::uint AddInstance(const glm::mat4 &model) override {
+        instModels.emplace_back(model);
+        ++instVer;
+        ++instModelVer;
+        return instModels.size() - 1;
+    }
+    virtual void SetInstanceModel(glm::uint instIdx,
+                                  const glm::mat4 &model) override {
+        instModels[instIdx] = model;
+        ++instModelVer;
+    }
+    virtual void ClearInstances() override {
+        instModels.clear();
+        ++instVer;
+        ++instModelVer;
+    }
     virtual void SetView(const glm::mat4 &view) override {
         V = view;
         MVP = P * V * M;
@@ -77,10 +137,67 @@ class RasterizerImpl : virtual public Rasterizer {
         MVP = P * V * M;
     }
     virtual void SetRenderSize(const glm::uvec2 &rndrSz) override;
+    virtual void SetDepthReprojection(bool enable) override {
+        depReproj = enable;
+    }
+    virtual void SetCacheDirectory(const std::string &dir) override {
+        cacheDir = dir;
+    }
+    // Only the hierarchical rasterizer has an octree to draw proxies and
+    // impostors of, and to restrict by a PVS
+    virtual void SetLODThreshold(float pxErr) override {
+        lodThreshold = pxErr;
+    }
+    virtual void SetImpostorCache(size_t budget, float angTol,
+                                  float sizeTol) override {
+        impostorBudget = budget;
+        impostorAngTol = angTol;
+        impostorSizeTol = sizeTol;
+    }
+    virtual void SetPVS(std::shared_ptr<const PVS> pvs) override {
+        this->pvs = pvs;
+    }
+    virtual void RecordPVS(PVS &, size_t) override {}
     virtual const std::vector<glm::u8vec4> &GetColorOutput() override;
 
   protected:
+    bool hasUVs() const { return !uvs.empty() || compactUVs; }
+    bool hasNorms() const { return !norms.empty() || compactNorms; }
+    glm::vec3 getPosition(glm::uint vIdx) const {
+        return compact ? compact->GetPosition(vIdx) : positions[vIdx];
+    }
+    // Take the views of the vertex data of asset
+    void viewAsset();
     void runPreRasterization();
+    // Vertex processing of a single face into v2r with M and MVP.
+    // clipPos3 are its vertices already in Clip Space if not null, and
+    // cullBack is false if it is known to be front-facing.
+    // Returns false if it is culled or clipped away.
+    bool processFace(glm::uint fIdx, V2R &v2r,
+                     const std::array<glm::vec4, 3> *clipPos3 = nullptr,
+                     bool cullBack = true);
+    // As above, for a face given by its vertex, uv and normal indices
+    bool processFace(const std::array<glm::uint, 3> &vIdx3,
+                     const std::array<glm::uint, 3> &uvIdx3,
+                     const std::array<glm::uint, 3> &nIdx3, V2R &v2r,
+                     const std::array<glm::vec4, 3> *clipPos3 = nullptr,
+                     bool cullBack = true);
+    // Call f(instIdx) with M and MVP set to each instance's, or once
+    // with f(0) when there is no instance
+    template <typename F> void forEachInstance(const F &f) {
+        if (instModels.empty()) {
+            f((glm::uint)0);
+            return;
+        }
+        auto mdl = M;
+        for (glm::uint instIdx = 0; instIdx < instModels.size(); ++instIdx) {
+            M = instModels[instIdx];
+            MVP = P * V * M;
+            f(instIdx);
+        }
+        M = mdl;
+        MVP = P * V * M;
+    }
     inline glm::u8vec4 rgbF2rgbaU8(const glm::vec3 &rgb) {
         return glm::u8vec4{(glm::uint8)glm::clamp(rgb.r * 255.f, 0.f, 255.f),
                            (glm::uint8)glm::clamp(rgb.g * 255.f, 0.f, 255.f),
@@ -29,10 +29,7 @@ void kouek::SimpleHZBufferRasterizerImpl::SetRenderSize(
     sortedET.resize(rndrSz.y);
 }
 
-void kouek::SimpleHZBufferRasterizerImpl::Render() {
-    runPreRasterization();
-    runRasterization();
-}
+void kouek::SimpleHZBufferRasterizerImpl::Render() { runRasterization(); }
 
 void kouek::SimpleHZBufferRasterizerImpl::runRasterization() {
     auto depTestFace = [&](const V2R &v2r, glm::uvec2 min, glm::uvec2 max) {
@@ -120,7 +117,7 @@ void kouek::SimpleHZBufferRasterizerImpl::runRasterization() {
     glm::uint skipCnt = 0;
 #endif // SHOW_DRAW_FACE_NUM
 
-    auto run = [&](glm::uint fIdx) {
+    auto run = [&](glm::uint fIdx, bool drawn) {
         auto &v2r = v2rs[fIdx];
         if (v2r.vCnt == 0)
             return false;
@@ -131,6 +128,8 @@ void kouek::SimpleHZBufferRasterizerImpl::runRasterization() {
         if (!depTestFace(v2r, min, max))
             return false;
 
+        if (drawn)
+            return true;
 #ifdef SHOW_DRAW_FACE_NUM
         ++skipCnt;
 #endif // SHOW_DRAW_FACE_NUM
@@ -138,23 +137,52 @@ void kouek::SimpleHZBufferRasterizerImpl::runRasterization() {
         return true;
     };
 
-    tmpAFIs = std::move(activeFaceIndices);
-    for (auto fIdx : tmpAFIs)
-        if (run(fIdx))
-            activeFaceIndices.emplace(fIdx);
-
-    for (glm::uint fIdx = 0; fIdx < v2rs.size(); ++fIdx)
-        if (tmpAFIs.find(fIdx) == tmpAFIs.end())
-            if (run(fIdx))
-                activeFaceIndices.emplace(fIdx);
+    // Instances are indexed by position, forget them once changed
+    if (activeInstVer != instVer) {
+        activeFaces.clear();
+        activeInstVer = instVer;
+    }
+    activeFaces.resize(std::max<size_t>(instModels.size(), 1));
+
+    // Phase 1: draw faces visible in the last frame without testing,
+    // then build the mipmap from their depth at once
+    forEachInstance([&](glm::uint instIdx) {
+        runPreRasterization();
+        auto &prevAFs = activeFaces[instIdx];
+        prevAFs.resize(v2rs.size(), false);
+        for (glm::uint fIdx = 0; fIdx < v2rs.size(); ++fIdx)
+            if (prevAFs[fIdx] && v2rs[fIdx].vCnt != 0) {
+                auto [min, max] = getScrnAABB(v2rs[fIdx]);
+#ifdef SHOW_DRAW_FACE_NUM
+                ++skipCnt;
+#endif // SHOW_DRAW_FACE_NUM
+                rasFace(v2rs[fIdx], min, max, false);
+            }
+    });
+    buildZBufferMipmap(zbufferMipmap);
+
+    // Phase 2: test all faces, including those drawn in Phase 1,
+    // so that faces occluded now are evicted from the active set
+    forEachInstance([&](glm::uint instIdx) {
+        // v2rs still hold the only instance
+        if (instModels.size() > 1)
+            runPreRasterization();
+        tmpAFs.swap(activeFaces[instIdx]);
+        activeFaces[instIdx].assign(v2rs.size(), false);
+        for (glm::uint fIdx = 0; fIdx < v2rs.size(); ++fIdx)
+            if (run(fIdx, tmpAFs[fIdx]))
+                activeFaces[instIdx][fIdx] = true;
+    });
 
 #ifdef SHOW_DRAW_FACE_NUM
     std::cout << ">> draw face num (ras):\t" << skipCnt << std::endl;
 #endif // SHOW_DRAW_FACE_NUM
 }
 
-inline void kouek::SimpleHZBufferRasterizerImpl::rasFace(
-    const V2R &v2r, const glm::uvec2 &min, const glm::uvec2 &max) {
+inline void kouek::SimpleHZBufferRasterizerImpl::rasFace(const V2R &v2r,
+                                                        const glm::uvec2 &min,
+                                                        const glm::uvec2 &max,
+                                                        bool updMipmap) {
     initSortedET(v2r, 0);
 
     // Scanline Rendering
@@ -187,19 +215,19 @@ inline void kouek::SimpleHZBufferRasterizerImpl::rasFace(
                         v2r.vs[R->v2[0]].pos.w * oneMinusCoeff2[1] +
                             v2r.vs[R->v2[1]].pos.w * R->coeff};
         std::array<V2RDat::SurfDat, 2> surf2;
-        if (uvs) {
+        if (hasUVs()) {
             surf2[0].uv = v2r.vs[L->v2[0]].surf.uv * oneMinusCoeff2[0] +
                           v2r.vs[L->v2[1]].surf.uv * L->coeff;
             surf2[1].uv = v2r.vs[R->v2[0]].surf.uv * oneMinusCoeff2[1] +
                           v2r.vs[R->v2[1]].surf.uv * R->coeff;
-        } else if (colors) {
+        } else if (!colors.empty()) {
             surf2[0].col = v2r.vs[L->v2[0]].surf.col * oneMinusCoeff2[0] +
                            v2r.vs[L->v2[1]].surf.col * L->coeff;
             surf2[1].col = v2r.vs[R->v2[0]].surf.col * oneMinusCoeff2[1] +
                            v2r.vs[R->v2[1]].surf.col * R->coeff;
         }
         std::array<glm::vec4, 2> norm2, wdPos2;
-        if (norms) {
+        if (hasNorms()) {
             norm2[0] = v2r.vs[L->v2[0]].norm * oneMinusCoeff2[0] +
                        v2r.vs[L->v2[1]].norm * L->coeff;
             norm2[1] = v2r.vs[R->v2[0]].norm * oneMinusCoeff2[1] +
@@ -226,25 +254,26 @@ inline void kouek::SimpleHZBufferRasterizerImpl::rasFace(
             if (dep >= zbufferMipmap[0][rowLftIdx + x])
                 continue; // reject
             zbufferMipmap[0][rowLftIdx + x] = dep;
-            updateZBufferMipmap(x, y);
+            if (updMipmap)
+                updateZBufferMipmap(x, y);
 
             // Perspective Correction (Cont.)
             auto rhw = rhw2[0] * oneMinusScnLnCoeff + rhw2[1] * scnLnCoeff;
             rhw = 1.f / rhw;
 
             V2RDat::SurfDat surf;
-            if (uvs) {
+            if (hasUVs()) {
                 surf.uv =
                     surf2[0].uv * oneMinusScnLnCoeff + surf2[1].uv * scnLnCoeff;
                 surf.uv *= rhw;
-            } else if (colors) {
+            } else if (!colors.empty()) {
                 surf.col = surf2[0].col * oneMinusScnLnCoeff +
                            surf2[1].col * scnLnCoeff;
                 surf.col *= rhw;
             }
 
             glm::vec4 norm, wdPos;
-            if (norms) {
+            if (hasNorms()) {
                 norm = norm2[0] * oneMinusScnLnCoeff + norm2[1] * scnLnCoeff;
                 wdPos = wdPos2[0] * oneMinusScnLnCoeff + wdPos2[1] * scnLnCoeff;
                 norm *= rhw;
@@ -253,13 +282,13 @@ inline void kouek::SimpleHZBufferRasterizerImpl::rasFace(
 
             // Coloring
             glm::vec3 color{1.f, 1.f, 1.f};
-            if (uvs)
+            if (hasUVs())
                 ;
-            else if (colors)
+            else if (!colors.empty())
                 color = surf.col;
 
             // Shading
-            if (norms) {
+            if (hasNorms()) {
                 auto ambient = light.ambientStrength * light.ambientColor;
                 glm::vec3 N{norm};
                 N = glm::normalize(N);
@@ -5,7 +5,6 @@
 #include <h_z_buf_ras.h>
 
 #include <list>
-#include <unordered_set>
 
 namespace kouek {
 
@@ -34,8 +33,11 @@ class SimpleHZBufferRasterizerImpl : public RasterizerImpl,
     std::list<EdgeNode> activeEL;
 
   private:
-    std::unordered_set<glm::uint> activeFaceIndices;
-    std::unordered_set<glm::uint> tmpAFIs;
+    // faces passing the Depth Test in the last frame,
+    // by instance then face index
+    std::vector<std::vector<bool>> activeFaces;
+    std::vector<bool> tmpAFs;
+    glm::uint activeInstVer = 0;
 
   public:
     virtual void SetRenderSize(const glm::uvec2 &rndrSz) override;
@@ -178,8 +180,25 @@ class SimpleHZBufferRasterizerImpl : public RasterizerImpl,
             zbufferMipmap[lvl][idx] = far;
         }
     }
+    inline void buildZBufferMipmap(
+        std::array<std::vector<float>, Z_BUF_MIPMAP_LVL_NUM> &mipmap) {
+        for (uint8_t lvl = 1; lvl < Z_BUF_MIPMAP_LVL_NUM; ++lvl) {
+            auto &lower = mipmap[lvl - 1];
+            auto lowerW = rndrSzMipmap[lvl - 1].x;
+            size_t idx = 0;
+            for (glm::uint y = 0; y < rndrSzMipmap[lvl].y; ++y) {
+                auto lowerIdx = (size_t)(y << 1) * lowerW;
+                for (glm::uint x = 0; x < rndrSzMipmap[lvl].x;
+                     ++x, ++idx, lowerIdx += 2)
+                    mipmap[lvl][idx] =
+                        std::max(std::max(lower[lowerIdx], lower[lowerIdx + 1]),
+                                 std::max(lower[lowerIdx + lowerW],
+                                          lower[lowerIdx + lowerW + 1]));
+            }
+        }
+    }
     inline void rasFace(const V2R &v2r, const glm::uvec2 &min,
-                        const glm::uvec2 &max);
+                        const glm::uvec2 &max, bool updMipmap = true);
 };
 
 } // namespace kouek
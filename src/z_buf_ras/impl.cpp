@@ -19,14 +19,16 @@ void kouek::ZBufferRasterizerImpl::SetRenderSize(const glm::uvec2 &rndrSz) {
 }
 
 void kouek::ZBufferRasterizerImpl::Render() {
-    runPreRasterization();
-    runRasterization();
-}
-
-void kouek::ZBufferRasterizerImpl::runRasterization() {
     colorOutput.assign(resolution, glm::zero<glm::u8vec4>());
     zbuffer.assign(resolution, std::numeric_limits<float>::infinity());
 
+    forEachInstance([&](glm::uint) {
+        runPreRasterization();
+        runRasterization();
+    });
+}
+
+void kouek::ZBufferRasterizerImpl::runRasterization() {
     // Init Sorted Edge Tables
     for (glm::uint tIdx = 0; tIdx < v2rs.size(); ++tIdx) {
         auto &v2r = v2rs[tIdx];
@@ -129,19 +131,19 @@ void kouek::ZBufferRasterizerImpl::runRasterization() {
                             v2r.vs[R->v2[0]].pos.w * oneMinusCoeff2[1] +
                                 v2r.vs[R->v2[1]].pos.w * R->coeff};
             std::array<V2RDat::SurfDat, 2> surf2;
-            if (uvs) {
+            if (hasUVs()) {
                 surf2[0].uv = v2r.vs[L->v2[0]].surf.uv * oneMinusCoeff2[0] +
                               v2r.vs[L->v2[1]].surf.uv * L->coeff;
                 surf2[1].uv = v2r.vs[R->v2[0]].surf.uv * oneMinusCoeff2[1] +
                               v2r.vs[R->v2[1]].surf.uv * R->coeff;
-            } else if (colors) {
+            } else if (!colors.empty()) {
                 surf2[0].col = v2r.vs[L->v2[0]].surf.col * oneMinusCoeff2[0] +
                                v2r.vs[L->v2[1]].surf.col * L->coeff;
                 surf2[1].col = v2r.vs[R->v2[0]].surf.col * oneMinusCoeff2[1] +
                                v2r.vs[R->v2[1]].surf.col * R->coeff;
             }
             std::array<glm::vec4, 2> norm2, wdPos2;
-            if (norms) {
+            if (hasNorms()) {
                 norm2[0] = v2r.vs[L->v2[0]].norm * oneMinusCoeff2[0] +
                            v2r.vs[L->v2[1]].norm * L->coeff;
                 norm2[1] = v2r.vs[R->v2[0]].norm * oneMinusCoeff2[1] +
@@ -178,18 +180,18 @@ void kouek::ZBufferRasterizerImpl::runRasterization() {
                 rhw = 1.f / rhw;
 
                 V2RDat::SurfDat surf;
-                if (uvs) {
+                if (hasUVs()) {
                     surf.uv = surf2[0].uv * oneMinusScnLnCoeff +
                               surf2[1].uv * scnLnCoeff;
                     surf.uv *= rhw;
-                } else if (colors) {
+                } else if (!colors.empty()) {
                     surf.col = surf2[0].col * oneMinusScnLnCoeff +
                                surf2[1].col * scnLnCoeff;
                     surf.col *= rhw;
                 }
 
                 glm::vec4 norm, wdPos;
-                if (norms) {
+                if (hasNorms()) {
                     norm =
                         norm2[0] * oneMinusScnLnCoeff + norm2[1] * scnLnCoeff;
                     wdPos =
@@ -200,13 +202,13 @@ void kouek::ZBufferRasterizerImpl::runRasterization() {
 
                 // Coloring
                 glm::vec3 color{1.f, 1.f, 1.f};
-                if (uvs)
+                if (hasUVs())
                     ;
-                else if (colors)
+                else if (!colors.empty())
                     color = surf.col;
 
                 // Shading
-                if (norms) {
+                if (hasNorms()) {
                     auto ambient = light.ambientStrength * light.ambientColor;
                     glm::vec3 N{norm};
                     N = glm::normalize(N);
@@ -2,6 +2,7 @@
 #include <z_buf_ras.h>
 
 #include <chrono>
+#include <filesystem>
 #include <iostream>
 
 #include <array>
@@ -26,67 +27,86 @@ int main(int argc, char **argv) {
     cli::Parser parser(argc, argv);
     parser.set_required<std::string>("m", "model", "Model Path");
     parser.set_optional<uint32_t>("t", "test-time", 45, "Test Repeat Times");
+    parser.set_optional<std::string>(
+        "c", "cache-dir", "",
+        "Directory to Cache Acceleration Structures in, Empty to Disable");
+    parser.set_optional<bool>(
+        "k", "compact", false,
+        "Keep Vertices Quantized in Memory, Decoded as They Are Drawn");
     parser.run_and_exit_if_error();
 
     // Create rasterizer
     rasterizers[0] = ZBufferRasterizer::Create();
     rasterizers[1] = SimpleHZBufferRasterizer::Create();
     rasterizers[2] = HierarchicalZBufferRasterizer::Create();
-    for (auto &rasterizer : rasterizers)
+    for (auto &rasterizer : rasterizers) {
         rasterizer->SetRenderSize(rndrSz);
+        rasterizer->SetCacheDirectory(parser.get<std::string>("c"));
+    }
 
-    // Load model
+    // Load model, as is if it is written by convert
     auto modelPath = parser.get<std::string>("m");
-    auto positions = std::make_shared<std::vector<glm::vec3>>();
-    auto indices = std::make_shared<std::vector<glm::uint>>();
-    try {
-        kouek::Mesh mesh;
-        mesh.ReadFromFile(modelPath);
-        auto &vs = mesh.GetVS();
-        auto &fvs = mesh.GetFVS();
-        auto &vts = mesh.GetVTS();
-        auto &fvts = mesh.GetFVTS();
-        auto &vns = mesh.GetVNS();
-        auto &fvns = mesh.GetFVNS();
+    auto printLoadDuration = [&](auto beg, auto end) {
+        auto loadMs =
+            std::chrono::duration_cast<std::chrono::milliseconds>(end - beg)
+                .count();
+        auto fileMB = std::filesystem::file_size(modelPath) / (1024. * 1024.);
+        std::cout << ">> Load Duration: " << loadMs << " ms ("
+                  << fileMB / (std::max<long long>(loadMs, 1) / 1000.)
+                  << " MB/s)" << std::endl;
+    };
+    auto loadBeg = std::chrono::system_clock::now();
+    auto asset = MeshAsset::Load(modelPath);
+    if (asset) {
+        auto loadEnd = std::chrono::system_clock::now();
         std::cout << "Model: " << modelPath << std::endl;
-        std::cout << ">> Model Vertices Num: " << vs.size() << std::endl;
-        std::cout << ">> Model Faces Num: " << fvs.size() << std::endl;
-
-        (*positions) = vs;
-        indices->reserve(fvs.size() * 3);
-        for (const auto &idx3 : fvs)
-            for (uint8_t t = 0; t < 3; ++t)
-                indices->emplace_back(idx3[t]);
-        for (auto &rasterizer : rasterizers)
-            rasterizer->SetVertexData(positions, nullptr, indices);
-
-        std::shared_ptr<std::vector<glm::vec2>> uvs;
-        std::shared_ptr<std::vector<glm::uint>> uvIndices;
-        std::shared_ptr<std::vector<glm::vec3>> norms;
-        std::shared_ptr<std::vector<glm::uint>> nIndices;
-        if (!fvts.empty()) {
-            uvs = std::make_shared<std::vector<glm::vec2>>();
-            uvIndices = std::make_shared<std::vector<glm::uint>>();
-            (*uvs) = vts;
-            for (const auto &idx3 : fvts)
-                for (uint8_t t = 0; t < 3; ++t)
-                    uvIndices->emplace_back(idx3[t]);
-        }
-        if (!fvns.empty()) {
-            norms = std::make_shared<std::vector<glm::vec3>>();
-            nIndices = std::make_shared<std::vector<glm::uint>>();
-            (*norms) = vns;
-            for (const auto &idx3 : fvns)
-                for (uint8_t t = 0; t < 3; ++t)
-                    nIndices->emplace_back(idx3[t]);
+        std::cout << ">> Model Faces Num: " << asset->GetTriangleNum()
+                  << std::endl;
+        printLoadDuration(loadBeg, loadEnd);
+    } else {
+        try {
+            // Borrowed in place, the mesh lives as long as the asset
+            auto mesh = std::make_shared<kouek::Mesh>();
+            mesh->ReadFromFile(modelPath);
+            auto loadEnd = std::chrono::system_clock::now();
+            auto vs = mesh->GetVS();
+            auto &fvs = mesh->GetFVS();
+            auto &fvts = mesh->GetFVTS();
+            auto &fvns = mesh->GetFVNS();
+            std::cout << "Model: " << modelPath << std::endl;
+            std::cout << ">> Model Vertices Num: " << vs.size()
+                      << std::endl;
+            std::cout << ">> Model Faces Num: " << fvs.size() << std::endl;
+            printLoadDuration(loadBeg, loadEnd);
+
+            asset = MeshAsset::Create(
+                vs, {}, Mesh::ToIndices(fvs),
+                fvts.empty() ? StridedSpan<const glm::vec2>()
+                             : mesh->GetVTS(),
+                Mesh::ToIndices(fvts),
+                fvns.empty() ? StridedSpan<const glm::vec3>()
+                             : mesh->GetVNS(),
+                Mesh::ToIndices(fvns), mesh);
+            // Faces laid out by octree leaf, and welded, so that the vertex
+            // stage takes a single index per corner
+            if (auto reordered = asset->Reorder(); reordered)
+                asset = reordered;
+            if (!fvts.empty() || !fvns.empty())
+                if (auto welded = asset->Weld(); welded)
+                    asset = welded;
+        } catch (std::exception &exp) {
+            std::cout << "Model: " << modelPath << "loading failed."
+                      << std::endl;
+            std::cout << ">> Error: " << exp.what() << std::endl;
         }
-        for (auto &rasterizer : rasterizers)
-            rasterizer->SetTextureData(uvs, uvIndices, norms, nIndices);
-
-    } catch (std::exception &exp) {
-        std::cout << "Model: " << modelPath << "loading failed." << std::endl;
-        std::cout << ">> Error: " << exp.what() << std::endl;
     }
+    if (asset && parser.get<bool>("k"))
+        if (auto compacted = asset->Compact(); compacted)
+            asset = compacted;
+    // Shared by all rasterizers
+    if (asset)
+        for (auto &rasterizer : rasterizers)
+            rasterizer->SetMeshAsset(asset);
 
     // Render Config
     for (auto &rasterizer : rasterizers) {